@@ -6,6 +6,11 @@
 #include <tuple>
 #include "algotester.h"
 #include "algotester_generator.h"
+#include "checker_log.h"
+#include "score.h"
+#include "shm_ring.h"
+#include "state.h"
+#include <memory>
 using namespace std;
 
 #define FOR(i,a,b) for (int i = (a); i < (b); i++)
@@ -32,83 +37,27 @@ const int MAX_ACTIONS = 30'000'000;
 const int MAX_VM_ID = 1'000'000'000;
 const int MAX_CONT_ID = 1'000'000'000;
 
-struct VMType
+bool has_flag(int argc, char* argv[], string flag)
 {
-    int cpu;
-    int mem;
-    int price;
-
-    VMType(int cpu, int mem, int price)
-    {
-        this->cpu = cpu;
-        this->mem = mem;
-        this->price = price;
-    }
-};
-
-struct VM
-{
-    int cpu_used;
-    int mem_used;
-    int start_time;
-    int shutdown_time;
-    int vm_type;
-
-    VM(){}
-    VM(int start_time, int vm_type)
-    {
-        this->start_time = start_time;
-        this->shutdown_time = -1;
-
-        this->vm_type = vm_type;
-        this->cpu_used = 0;
-        this->mem_used = 0;
-    }
-};
-
-struct Container
-{
-    int cpu;
-    int mem;
-    int time;
-    int duration;
-    int id;
-
-    Container(){}
-    Container(int cpu, int mem, int time, int duration, int id)
-    {
-        this->cpu = cpu;
-        this->mem = mem;
-        this->time = time;
-        this->duration = duration;
-        this->id = id;
-    }
-};
-
-struct Event
-{
-    int type;
-    int time;
-    int container_id;
-
-    Event(int type, int time, int container_id)
-    {
-        this->type = type;
-        this->time = time;
-        this->container_id = container_id;
-    }
-};
+    // argv[1..5] are the positional arguments passed by the interactor
+    FOR (i, 6, argc)
+        if (argv[i] == flag)
+            return true;
+    return false;
+}
 
 int m, d;
-vector<VMType> vm_types;
+Cluster<HashedStorage, StrictValidation> cluster;
+vector<VMType>& vm_types = cluster.types;
 map<int, vector<Event> > events;
-map<int, Container> containers;
+HashedStorage<Container> requests; // all containers of the test
 int max_time = 0;
 
 void read_test(AlgotesterReader& in)
 {
     m = in.readInt();
     d = in.readInt();
+    cluster.d = d;
     vm_types.clear();
 
     FOR (i, 0, m)
@@ -130,7 +79,12 @@ void read_test(AlgotesterReader& in)
         int duration = in.readInt();
 
         events[time].PB(Event(1, time, id));
-        containers[id] = Container(cpu, mem, time, duration, id);
+        Container request;
+        request.cpu = cpu;
+        request.mem = mem;
+        request.arrival = time;
+        request.duration = duration;
+        requests.insert(id, request);
 
         max_time = max(max_time, time + duration);
     }
@@ -142,16 +96,36 @@ int main(int argc, char* argv[])
 
     auto gen = initGenerator(argc, argv);
 
-    auto [test_in, user_in, user_out] = initInteractiveChecker(argc, argv);
-    auto output = ofstream(argv[5]);
+    // With --shm argv[1] and argv[2] are shared-memory rings instead of FIFOs
+    bool use_shm = has_flag(argc, argv, "--shm");
+    auto [test_in, user_in, user_out] = use_shm ? initShmInteractiveChecker(argc, argv) : initInteractiveChecker(argc, argv);
+    if (use_shm)
+        useShmOutput(user_in);
+    // With --score the checker scores the interaction itself and the log is only written if --keep-log is given
+    bool fused_score = has_flag(argc, argv, "--score");
+    unique_ptr<LogWriter> log;
+    if (!fused_score || has_flag(argc, argv, "--keep-log"))
+        log = make_unique<LogWriter>(argv[5], has_flag(argc, argv, "--binary-log"));
 
     auto error = [&user_in](){user_in << -1 << endl;};
     user_out.setErrorCallback(error);
 
     auto checkWithError = [&error](bool condition, string message) {check(condition, message, error);};
+    cluster.validation.fail = [&checkWithError](const string& message) {checkWithError(false, message);};
 
     read_test(test_in);
 
+    VI vm_cpus, vm_prices;
+    FOR (i, 0, m)
+    {
+        vm_cpus.PB(vm_types[i].cpu);
+        vm_prices.PB(vm_types[i].price);
+    }
+    unique_ptr<ScoreAccumulator> score;
+    if (fused_score)
+        score = make_unique<ScoreAccumulator>(vm_cpus, vm_prices);
+    LogTee<LogWriter, ScoreAccumulator> output(log.get(), score.get());
+
     user_in << m << ' ' << d << "\n";
     FOR (i, 0, m)
     {
@@ -160,13 +134,10 @@ int main(int argc, char* argv[])
 
     int t = max_time + TIME_AT_THE_END;
     user_in << t << "\n";
-    output << t << "\n";
+    output.begin(t);
     // cerr << t << "\n";
 
-    set<int> unallocated_containers;
     int actions_count = 0;
-    map<int, VM> vms;
-    map<int, int> container_vm;
 
     FOR (j, 0, t)
     {
@@ -178,28 +149,29 @@ int main(int argc, char* argv[])
             int r = iter == events.end() ? t : iter -> first;
             cnt = gen.randInt(1, min(20, r - j));
             user_in << "0 " << cnt << "\n";
-            output << "0 " << cnt << "\n";
+            output.step(j, 0, cnt);
             // cerr << "0 " << cnt << "\n";
         }
         else
         {
             vector<Event>& e = events[j];
             user_in << SZ(e) << "\n";
-            output << SZ(e) << "\n";
+            output.step(j, SZ(e), 1);
             // cerr << SZ(e) << "\n";
             FOR (k, 0, SZ(e))
             {
                 if (e[k].type == 1)
                 {
-                    user_in << "1 " << e[k].container_id << ' ' << containers[e[k].container_id].cpu << ' ' << containers[e[k].container_id].mem << "\n";
-                    output << "1 " << e[k].container_id << ' ' << containers[e[k].container_id].cpu << ' ' << containers[e[k].container_id].mem << "\n";
-                    // cerr << "1 " << e[k].container_id << ' ' << containers[e[k].container_id].cpu << ' ' << containers[e[k].container_id].mem << "\n";
-                    unallocated_containers.insert(e[k].container_id);
+                    auto& request = requests[e[k].container_id];
+                    user_in << "1 " << e[k].container_id << ' ' << request.cpu << ' ' << request.mem << "\n";
+                    output.containerNew(j, e[k].container_id, request.cpu, request.mem);
+                    // cerr << "1 " << e[k].container_id << ' ' << request.cpu << ' ' << request.mem << "\n";
+                    cluster.containerNew(j, e[k].container_id, request.cpu, request.mem, request.duration);
                 }
                 else
                 {
                     user_in << "2 " << e[k].container_id << "\n";
-                    output << "2 " << e[k].container_id << "\n";
+                    output.containerEnd(j, e[k].container_id);
                     // cerr << "2 " << e[k].container_id << "\n";
                     containers_to_shutdown.PB(e[k].container_id);
                 }
@@ -212,10 +184,9 @@ int main(int argc, char* argv[])
         FOR (it, 0, cnt)
         {
             j++;
-            set<int> vms_to_shutdown;
 
             int a = user_out.readInt(0, MAX_ACTIONS - actions_count, "a_j");
-            output << a << "\n";
+            output.actions(j, a);
             // cerr << "==> " << a << "\n";
             actions_count += a;
 
@@ -227,81 +198,51 @@ int main(int argc, char* argv[])
                     int id = user_out.readInt(1, MAX_VM_ID, "id^{vm}_{jk}");
                     int vm_type = user_out.readInt(1, m, "type^{vm}_{jk}");
 
-                    output << "1 " << id << ' ' << vm_type << "\n";
+                    output.vmCreate(j, id, vm_type);
                     // cerr << "==> 1 " << id << ' ' << vm_type << "\n";
 
-                    checkWithError(vms.count(id) == 0, "VM with such identifier has already been created");
-                    vms[id] = VM(j, vm_type - 1);
+                    cluster.vmCreate(j, id, vm_type - 1);
                 }
                 if (type == 2)
                 {
                     int id = user_out.readInt(1, MAX_VM_ID, "id^{vm}_{jk}");
 
-                    output << "2 " << id << "\n";
+                    output.vmShutdown(j, id);
                     // cerr << "==> 2 " << id << "\n";
-                    
-                    checkWithError(vms.count(id) != 0, "VM with such identifier has not been created yet");
-                    
-                    auto& vm = vms[id];
-                    checkWithError(vm.shutdown_time == -1, "VM can not be shut down because it is has been already shut down");
-                    checkWithError(vms_to_shutdown.count(id) == 0, "VM has already been scheduled to shut down");
-                    checkWithError(vm.cpu_used == 0 && vm.mem_used == 0, "VM can not be shut down because it hosts containers");
-                    
-                    vms_to_shutdown.insert(id);
+
+                    // Containers that end on this step still count, they are released after the actions
+                    cluster.vmShutdown(j, id);
                 }
                 if (type == 3)
                 {
                     int id_cont = user_out.readInt(1, MAX_CONT_ID, "id^{cont}_{jk}");
                     int id_vm = user_out.readInt(1, MAX_VM_ID, "id^{vm}_{jk}");
 
-                    output << "3 " << id_cont << ' ' << id_vm << "\n";
+                    output.assign(j, id_cont, id_vm);
                     // cerr << "==> 3 " << id_cont << ' ' << id_vm << "\n";
-                    checkWithError(unallocated_containers.count(id_cont) != 0, "No such container request, or it has already been allocated");
-                    unallocated_containers.erase(id_cont);
-                    auto container = containers[id_cont];
-
-                    checkWithError(vms.count(id_vm) != 0, "VM with such identifier has not been created yet");
-                    auto& vm = vms[id_vm];
-                    checkWithError(vm.shutdown_time == -1, "VM has already been shut down");
-                    checkWithError(vms_to_shutdown.count(id_vm) == 0, "VM is scheduled to shut down on this step");
-                    checkWithError(j >= vm.start_time + d, "VM is not ready to host containers");
-                    checkWithError(vm.cpu_used + container.cpu <= vm_types[vm.vm_type].cpu, "VM doesn't have enough CPUs to host container");
-                    checkWithError(vm.mem_used + container.mem <= vm_types[vm.vm_type].mem, "VM doesn't have enough memory to host container");
-
-                    vm.cpu_used += container.cpu;
-                    vm.mem_used += container.mem;
-                    container_vm[id_cont] = id_vm;
+                    auto& container = cluster.assign(j, id_cont, id_vm);
 
                     events[j + container.duration].PB(Event(2, j + container.duration, id_cont));
                 }
             }
 
             FOR (k, 0, SZ(containers_to_shutdown))
-            {
-                int id_cont = containers_to_shutdown[k];
-                int id_vm = container_vm[id_cont];
-
-                auto& vm = vms[id_vm];
-                vm.cpu_used -= containers[id_cont].cpu;
-                vm.mem_used -= containers[id_cont].mem;
-            }
-
-            ITER(it, vms_to_shutdown)
-            {
-                vms[*it].shutdown_time = j;
-            }
+                cluster.containerEnd(j, containers_to_shutdown[k]);
         }
     }
 
-    checkWithError(SZ(unallocated_containers) == 0, "Not all containers have been allocated");
+    checkWithError(cluster.unallocated == 0, "Not all containers have been allocated");
 
     user_in << 0 << "\n";
-    output << 0 << "\n";
+    output.end();
     // cerr << 0 << "\n";
     
     user_in.flush();
     
     user_out.readEof();
+
+    if (score)
+        cout << score->score() << endl;
 }
 
 
@@ -0,0 +1,384 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace std;
+
+// Throughput benchmark of the checker: drives it with a synthetic solution that sends a valid stream of close to
+// MAX_ACTIONS actions and reports actions per second, memory and the time of every phase as JSON.
+//
+// Usage: ./checker_bench [actions=29000000] [containers=1000000] [lifetime=40] [mode=<fused|log|binary>] [checker=./checker]
+//
+// The test is written by the benchmark: `containers` short containers arriving over 20000 steps. The solution
+// creates a pool of hosts at step 0, assigns every container on arrival and spends the rest of the budget on
+// churn: VMs that are created and shut down `lifetime` steps later. VM ids are scattered over [1, 1e9] and are
+// never reused, so the checker keeps a record for every one of them until the end.
+// mode=fused scores inside the checker (--score), log and binary write a text or a binary log instead.
+//
+// Phases, measured from outside the checker: read_test (start to the header sent to the solution), interaction
+// (header to the final message) and finish (final message to exit). CPU time of the checker is sampled from /proc
+// at the phase boundaries.
+
+extern char** environ;
+
+typedef chrono::steady_clock Clock;
+
+const int ARRIVAL_STEPS = 20000;
+const int MAX_DURATION = 10;
+const int D = 40;
+const int CONT_CPU = 400, CONT_MEM = 1024;
+const int HOST_CPU = 64 * CONT_CPU, HOST_MEM = 64 * CONT_MEM, HOST_SLOTS = 64;
+const int ID_PRIME = 999999937; // VM ids are k * ID_MULTIPLIER mod ID_PRIME + 1, distinct for k < ID_PRIME
+const long long ID_MULTIPLIER = 387420489;
+
+struct Options
+{
+    long long actions = 29'000'000;
+    int containers = 1'000'000;
+    int lifetime = D;
+    string mode = "fused";
+    string checker = "./checker";
+};
+
+struct Phase
+{
+    double wall = 0;
+    double cpu = 0;
+};
+
+/// @brief User plus system time of a running process, from /proc.
+double process_cpu(pid_t pid)
+{
+    string path = "/proc/" + to_string(pid) + "/stat";
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f)
+        return 0;
+    char buffer[1024];
+    size_t len = fread(buffer, 1, sizeof(buffer) - 1, f);
+    fclose(f);
+    buffer[len] = 0;
+    // Fields after the command name, which is in parentheses and may contain spaces
+    char* p = strrchr(buffer, ')');
+    unsigned long utime = 0, stime = 0;
+    if (p)
+        sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime);
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+/// @brief Resident memory of a running process in kB, from /proc.
+long process_rss_kb(pid_t pid)
+{
+    string path = "/proc/" + to_string(pid) + "/status";
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f)
+        return 0;
+    char line[256];
+    long res = 0;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "VmRSS: %ld", &res) == 1)
+            break;
+    fclose(f);
+    return res;
+}
+
+/// @brief Buffered line reader over a descriptor.
+class LineReader
+{
+public:
+    explicit LineReader(int fd): fd(fd), buffer(1 << 16) {}
+
+    /// @brief Next line without the newline, false at the end of the stream.
+    bool next(string& line)
+    {
+        line.clear();
+        while (true)
+        {
+            if (pos == len)
+            {
+                ssize_t res = read(fd, buffer.data(), buffer.size());
+                if (res <= 0)
+                    return !line.empty();
+                pos = 0;
+                len = res;
+            }
+            char* end = (char*)memchr(buffer.data() + pos, '\n', len - pos);
+            size_t stop = end ? end - buffer.data() : len;
+            line.append(buffer.data() + pos, stop - pos);
+            pos = end ? stop + 1 : len;
+            if (end)
+                return true;
+        }
+    }
+
+private:
+    int fd;
+    vector<char> buffer;
+    size_t pos = 0;
+    size_t len = 0;
+};
+
+bool write_all(int fd, const string& s)
+{
+    size_t done = 0;
+    while (done < s.size())
+    {
+        ssize_t res = write(fd, s.data() + done, s.size() - done);
+        if (res <= 0)
+            return false;
+        done += res;
+    }
+    return true;
+}
+
+void write_test(const string& path, const Options& options)
+{
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f)
+    {
+        perror(path.c_str());
+        exit(2);
+    }
+    fprintf(f, "2 %d\n%d %d 1000\n%d %d 150\n%d\n", D, HOST_CPU, HOST_MEM, 8 * CONT_CPU, 8 * CONT_MEM, options.containers);
+    for (int i = 0; i < options.containers; i++)
+    {
+        int time = D + (int)((long long)i * ARRIVAL_STEPS / options.containers);
+        int duration = 1 + (int)((i * 7919LL) % MAX_DURATION);
+        fprintf(f, "%d %d %d %d %d\n", time, i + 1, CONT_CPU, CONT_MEM, duration);
+    }
+    fclose(f);
+}
+
+int main(int argc, char* argv[])
+{
+    signal(SIGPIPE, SIG_IGN);
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq), value = eq == string::npos ? "" : arg.substr(eq + 1);
+        if (key == "actions")
+            options.actions = atoll(value.c_str());
+        else if (key == "containers")
+            options.containers = atoi(value.c_str());
+        else if (key == "lifetime")
+            options.lifetime = atoi(value.c_str());
+        else if (key == "mode")
+            options.mode = value;
+        else if (key == "checker")
+            options.checker = value;
+        else
+        {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (options.containers < 1 || options.lifetime < 1 || options.actions < options.containers
+        || (options.mode != "fused" && options.mode != "log" && options.mode != "binary"))
+    {
+        fprintf(stderr, "Usage: ./checker_bench [actions=29000000] [containers=1000000] [lifetime=40] [mode=<fused|log|binary>] [checker=./checker]\n");
+        return 2;
+    }
+
+    char test_path[] = "/tmp/checker_bench_test_XXXXXX", log_path[] = "/tmp/checker_bench_log_XXXXXX";
+    close(mkstemp(test_path));
+    close(mkstemp(log_path));
+    write_test(test_path, options);
+
+    // Hosts for the largest number of live containers: arrivals of one step times the steps a slot stays taken
+    int per_step = (options.containers + ARRIVAL_STEPS - 1) / ARRIVAL_STEPS;
+    int hosts = (per_step * (MAX_DURATION + 2) + HOST_SLOTS - 1) / HOST_SLOTS;
+
+    int to_solution[2], to_checker[2], checker_stdout[2];
+    if (pipe2(to_solution, O_CLOEXEC) != 0 || pipe2(to_checker, O_CLOEXEC) != 0 || pipe2(checker_stdout, O_CLOEXEC) != 0)
+    {
+        perror("pipe");
+        return 2;
+    }
+    int test_fd = open(test_path, O_RDONLY | O_CLOEXEC);
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawn_file_actions_adddup2(&file_actions, test_fd, 0);
+    posix_spawn_file_actions_adddup2(&file_actions, checker_stdout[1], 1);
+    posix_spawn_file_actions_adddup2(&file_actions, to_solution[1], 3);
+    posix_spawn_file_actions_adddup2(&file_actions, to_checker[0], 4);
+    vector<string> command = {options.checker, "/dev/fd/3", "/dev/fd/4", "0", "0", options.mode == "fused" ? "/dev/null" : log_path};
+    if (options.mode == "fused")
+        command.push_back("--score");
+    if (options.mode == "binary")
+        command.push_back("--binary-log");
+    vector<char*> checker_argv;
+    for (auto& arg : command)
+        checker_argv.push_back(const_cast<char*>(arg.c_str()));
+    checker_argv.push_back(nullptr);
+
+    Phase read_test, interaction, finish;
+    auto start = Clock::now();
+    pid_t pid;
+    int res = posix_spawnp(&pid, checker_argv[0], &file_actions, nullptr, checker_argv.data(), environ);
+    posix_spawn_file_actions_destroy(&file_actions);
+    if (res != 0)
+    {
+        fprintf(stderr, "Cannot start %s: %s\n", checker_argv[0], strerror(res));
+        return 2;
+    }
+    close(test_fd);
+    close(to_solution[1]);
+    close(to_checker[0]);
+    close(checker_stdout[1]);
+
+    LineReader in(to_solution[0]);
+    int out = to_checker[1];
+    string line, response;
+    string message;
+    bool ok = in.next(line);
+    auto header_time = Clock::now();
+    read_test.wall = chrono::duration<double>(header_time - start).count();
+    read_test.cpu = process_cpu(pid);
+    long rss_after_test = process_rss_kb(pid);
+
+    // Header
+    int m = 0, t = 0;
+    if (ok)
+    {
+        m = atoi(line.c_str());
+        for (int i = 0; i <= m && ok; i++)
+            ok = in.next(line);
+        t = atoi(line.c_str());
+    }
+
+    // Churn VMs are spread evenly over the steps where they can still be shut down
+    long long churn = max(0LL, (options.actions - options.containers - hosts) / 2);
+    long long churn_steps = max(1, t - options.lifetime);
+    long long created = 0, actions = 0;
+    vector<int> slots, freed;
+    for (int h = hosts; h-- > 0; )
+        for (int k = 0; k < HOST_SLOTS; k++)
+            slots.push_back(h);
+    vector<int> host_of(options.containers + 1, -1);
+    auto vm_id = [](long long k) { return (int)(k * ID_MULTIPLIER % ID_PRIME) + 1; };
+    auto churn_before = [&](long long j) { return j >= churn_steps ? churn : churn * j / churn_steps; };
+
+    int j = 0;
+    while (ok && in.next(line))
+    {
+        if (line == "0" || line == "-1")
+        {
+            if (line == "-1")
+                message = "checker rejected the stream";
+            break;
+        }
+        int events = 0, cnt = 1;
+        vector<int> arrived;
+        // "0 <cnt>" for idle steps, "<events>" otherwise
+        if (sscanf(line.c_str(), "%d %d", &events, &cnt) < 2)
+            cnt = 1;
+        for (int e = 0; e < events && ok; e++)
+        {
+            ok = in.next(line);
+            int type, id;
+            sscanf(line.c_str(), "%d %d", &type, &id);
+            if (type == 1)
+                arrived.push_back(id);
+            else
+                freed.push_back(host_of[id]);
+        }
+
+        response.clear();
+        for (int k = 0; k < cnt; k++, j++)
+        {
+            string step;
+            int a = 0;
+            auto add = [&](const char* format, int x, int y) {
+                char buffer[64];
+                snprintf(buffer, sizeof(buffer), format, x, y);
+                step += buffer;
+                a++;
+            };
+            if (j == 0)
+                for (int h = 0; h < hosts; h++)
+                    add("1 %d %d\n", vm_id(h), 1);
+            if (k == 0)
+                for (int id : arrived)
+                {
+                    host_of[id] = slots.back();
+                    slots.pop_back();
+                    add("3 %d %d\n", id, vm_id(host_of[id]));
+                }
+            if (j >= options.lifetime)
+                for (long long v = churn_before(j - options.lifetime); v < churn_before(j - options.lifetime + 1); v++)
+                    add("2 %d\n", vm_id(hosts + v), 0);
+            for (; created < churn_before(j + 1); created++)
+                add("1 %d %d\n", vm_id(hosts + created), 2);
+            response += to_string(a) + "\n" + step;
+            actions += a;
+        }
+        // Slots of containers that ended on this message are released after its actions
+        slots.insert(slots.end(), freed.begin(), freed.end());
+        freed.clear();
+        if (!write_all(out, response))
+            break;
+    }
+    auto end_time = Clock::now();
+    interaction.wall = chrono::duration<double>(end_time - header_time).count();
+    interaction.cpu = process_cpu(pid) - read_test.cpu;
+    close(out);
+
+    string checker_output;
+    LineReader checker_out(checker_stdout[0]);
+    while (checker_out.next(line))
+        checker_output += line + "\n";
+    close(checker_stdout[0]);
+    int status;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    close(to_solution[0]);
+    double checker_cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    finish.wall = chrono::duration<double>(Clock::now() - end_time).count();
+    finish.cpu = max(0.0, checker_cpu - read_test.cpu - interaction.cpu);
+    struct rusage self;
+    getrusage(RUSAGE_SELF, &self);
+    double solution_cpu = self.ru_utime.tv_sec + self.ru_utime.tv_usec / 1e6 + self.ru_stime.tv_sec + self.ru_stime.tv_usec / 1e6;
+    long log_kb = 0;
+    if (options.mode != "fused")
+    {
+        struct stat st;
+        if (stat(log_path, &st) == 0)
+            log_kb = st.st_size / 1024;
+    }
+    unlink(test_path);
+    unlink(log_path);
+
+    bool exited = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (message.empty() && (!exited || !ok))
+        message = "checker failed";
+    if (!message.empty() && !checker_output.empty())
+        message += ": " + checker_output.substr(0, checker_output.find('\n'));
+
+    printf("{\n");
+    printf("  \"mode\": \"%s\",\n", options.mode.c_str());
+    printf("  \"verdict\": \"%s\",\n", message.empty() ? "ok" : "error");
+    if (!message.empty())
+        printf("  \"message\": \"%s\",\n", message.c_str());
+    printf("  \"steps\": %d,\n  \"containers\": %d,\n  \"vms\": %lld,\n  \"actions\": %lld,\n", t, options.containers, hosts + created, actions);
+    printf("  \"phases\": {\n");
+    printf("    \"read_test\": {\"wall_s\": %.3f, \"cpu_s\": %.3f},\n", read_test.wall, read_test.cpu);
+    printf("    \"interaction\": {\"wall_s\": %.3f, \"cpu_s\": %.3f},\n", interaction.wall, interaction.cpu);
+    printf("    \"finish\": {\"wall_s\": %.3f, \"cpu_s\": %.3f}\n", finish.wall, finish.cpu);
+    printf("  },\n");
+    printf("  \"checker\": {\"cpu_s\": %.3f, \"rss_after_test_kb\": %ld, \"max_rss_kb\": %ld, \"log_kb\": %ld},\n", checker_cpu, rss_after_test, usage.ru_maxrss, log_kb);
+    printf("  \"solution_cpu_s\": %.3f,\n", solution_cpu);
+    printf("  \"actions_per_s\": %.0f,\n", actions / max(interaction.wall, 1e-9));
+    printf("  \"actions_per_checker_cpu_s\": %.0f\n", actions / max(interaction.cpu, 1e-9));
+    printf("}\n");
+    return message.empty() ? 0 : 1;
+}
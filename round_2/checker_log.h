@@ -0,0 +1,468 @@
+// Checker log formats.
+//
+// The checker records the whole interaction so that the scorer can evaluate it afterwards.
+// Two encodings are supported:
+//  * text   - the protocol as it was sent over the pipes (the original format);
+//  * binary - a header followed by fixed-width little-endian records with a delta-encoded time field.
+// Both are read through the same visitor interface, so consumers do not care which one they get.
+
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "algotester.h"
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Binary checker log is defined as little-endian");
+
+const char BINLOG_MAGIC[4] = {'H', 'L', 'O', 'G'};
+const uint32_t BINLOG_VERSION = 1;
+
+enum BinLogKind : uint32_t
+{
+    BL_STEP = 1,        // a = number of events (0 for idle steps), b = number of steps in the group,
+                        // c = number of following steps without actions (idle steps only)
+    BL_CONT_NEW = 2,    // a = container id, b = cpu, c = mem
+    BL_CONT_END = 3,    // a = container id
+    BL_ACTIONS = 4,     // a = number of actions on this step
+    BL_VM_CREATE = 5,   // a = vm id, b = vm type (1-based)
+    BL_VM_SHUTDOWN = 6, // a = vm id
+    BL_ASSIGN = 7,      // a = container id, b = vm id
+    BL_END = 8,         // final 0 of the protocol
+    BL_TIME = 9         // a = time delta that did not fit into the record
+};
+
+struct BinLogHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t record_size;
+    int32_t t;
+};
+
+/// @brief Fixed-width log record.
+/// @note `head` packs kind (bits 0-3), time delta from the previous record (bits 4-7) and a third operand (bits 8-31).
+struct BinLogRecord
+{
+    uint32_t head;
+    int32_t a;
+    int32_t b;
+
+    uint32_t kind() const { return head & 15; }
+    uint32_t dt() const { return (head >> 4) & 15; }
+    int32_t c() const { return (int32_t)(head >> 8); }
+};
+
+static_assert(sizeof(BinLogHeader) == 16, "Unexpected binary log header layout");
+static_assert(sizeof(BinLogRecord) == 12, "Unexpected binary log record layout");
+
+const int BINLOG_MAX_DT = 15;
+const int BINLOG_MAX_C = (1 << 24) - 1;
+
+/// @brief Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+    MappedFile(const string& filename)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        check(fd != -1, "Cannot open " + filename);
+        struct stat st;
+        check(fstat(fd, &st) == 0, "Cannot stat " + filename);
+        size = st.st_size;
+        if (size > 0)
+        {
+            data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            check(data != MAP_FAILED, "Cannot map " + filename);
+            madvise(data, size, MADV_SEQUENTIAL);
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+        if (size > 0)
+            munmap(data, size);
+    }
+
+    const char* begin() const { return (const char*)data; }
+    const char* end() const { return begin() + size; }
+
+    /// @brief Drop already consumed pages from memory, so that a sequential pass does not keep the whole file resident.
+    /// @return Position up to which the pages were released.
+    const char* release(const char* upto) const
+    {
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t len = (upto - begin()) / page * page;
+        if (len > 0)
+            madvise(data, len, MADV_DONTNEED);
+        return begin() + len;
+    }
+
+private:
+    void* data = nullptr;
+    size_t size;
+};
+
+/// @brief Base class for log consumers. Derived classes hide the callbacks they are interested in.
+struct LogVisitor
+{
+    void begin(int t) {}
+    void step(int j, int e, int cnt) {}
+    void containerNew(int j, int id, int cpu, int mem) {}
+    void containerEnd(int j, int id) {}
+    void actions(int j, int a) {}
+    void vmCreate(int j, int id, int vm_type) {}
+    void vmShutdown(int j, int id) {}
+    void assign(int j, int id_cont, int id_vm) {}
+    void end() {}
+};
+
+/// @brief Check whether the file starts with the binary log magic.
+bool isBinaryLog(const string& filename)
+{
+    char magic[4] = {};
+    FILE* f = fopen(filename.c_str(), "rb");
+    if (!f)
+        return false;
+    size_t len = fread(magic, 1, sizeof(magic), f);
+    fclose(f);
+    return len == sizeof(magic) && memcmp(magic, BINLOG_MAGIC, sizeof(magic)) == 0;
+}
+
+/// @brief Non-validating integer reader over a memory-mapped text log.
+/// @note The log is produced by the checker, so it is trusted; use `AlgotesterReader` for anything else.
+class MappedTextReader
+{
+public:
+    MappedTextReader(const string& filename): file(filename), pos(file.begin()), released(file.begin()) {}
+
+    long long readInt()
+    {
+        const char* end = file.end();
+        while (pos != end && (*pos < '0' || *pos > '9') && *pos != '-')
+            pos++;
+        if (pos == end)
+            check(false, "Unexpected end of log");
+        bool neg = *pos == '-';
+        if (neg)
+            pos++;
+        long long res = 0;
+        while (pos != end && *pos >= '0' && *pos <= '9')
+            res = res * 10 + (*pos++ - '0');
+        if (pos - released > RELEASE_CHUNK)
+            released = file.release(pos);
+        return neg ? -res : res;
+    }
+
+private:
+    static const long RELEASE_CHUNK = 64 << 20;
+
+    MappedFile file;
+    const char* pos;
+    const char* released;
+};
+
+/// @brief Walk a text checker log and report its contents to the visitor.
+/// @tparam Reader `AlgotesterReader` or `MappedTextReader`.
+template<class Reader, class Visitor>
+void visitTextLog(Reader& in, Visitor& visitor)
+{
+    int t = in.readInt();
+    visitor.begin(t);
+    for (int j = 0; j < t; j++)
+    {
+        int e = in.readInt();
+        int cnt = 1;
+        if (e == 0) cnt = in.readInt();
+        visitor.step(j, e, cnt);
+
+        for (int k = 0; k < e; k++)
+        {
+            int type = in.readInt();
+            if (type == 1)
+            {
+                int id = in.readInt();
+                int cpu = in.readInt();
+                int mem = in.readInt();
+                visitor.containerNew(j, id, cpu, mem);
+            }
+            if (type == 2)
+                visitor.containerEnd(j, in.readInt());
+        }
+
+        j--;
+        for (int it = 0; it < cnt; it++)
+        {
+            j++;
+            int a = in.readInt();
+            visitor.actions(j, a);
+            for (int k = 0; k < a; k++)
+            {
+                int type = in.readInt();
+                if (type == 1)
+                {
+                    int id = in.readInt();
+                    int vm_type = in.readInt();
+                    visitor.vmCreate(j, id, vm_type);
+                }
+                if (type == 2)
+                    visitor.vmShutdown(j, in.readInt());
+                if (type == 3)
+                {
+                    int id_cont = in.readInt();
+                    int id_vm = in.readInt();
+                    visitor.assign(j, id_cont, id_vm);
+                }
+            }
+        }
+    }
+    visitor.end();
+}
+
+/// @brief Read-only view of a binary checker log mapped into memory.
+class BinLogReader
+{
+public:
+    BinLogReader(const string& filename): file(filename)
+    {
+        size_t size = file.end() - file.begin();
+        check(size >= sizeof(BinLogHeader), "Binary log is truncated");
+        header = (const BinLogHeader*)file.begin();
+        check(memcmp(header->magic, BINLOG_MAGIC, sizeof(BINLOG_MAGIC)) == 0, "Not a binary log");
+        check(header->version == BINLOG_VERSION, "Unsupported binary log version " + to_string(header->version));
+        check(header->record_size == sizeof(BinLogRecord), "Unexpected binary log record size");
+        check((size - sizeof(BinLogHeader)) % sizeof(BinLogRecord) == 0, "Binary log is truncated");
+    }
+
+    int t() const { return header->t; }
+
+    const BinLogRecord* begin() const { return (const BinLogRecord*)(header + 1); }
+    const BinLogRecord* end() const { return (const BinLogRecord*)file.end(); }
+
+    /// @brief Report all records to the visitor, restoring absolute times from the deltas.
+    template<class Visitor>
+    void visit(Visitor& visitor) const
+    {
+        visitor.begin(t());
+        int j = 0;
+        const char* released = file.begin();
+        for (const BinLogRecord* r = begin(); r != end(); r++)
+        {
+            if ((const char*)r - released > RELEASE_CHUNK)
+                released = file.release((const char*)r);
+            j += r->dt();
+            switch (r->kind())
+            {
+                case BL_STEP:
+                    visitor.step(j, r->a, r->b);
+                    for (int i = 0; i < r->c(); i++)
+                        visitor.actions(j + i, 0);
+                    if (r->c() > 0)
+                        j += r->c() - 1;
+                    break;
+                case BL_CONT_NEW: visitor.containerNew(j, r->a, r->b, r->c()); break;
+                case BL_CONT_END: visitor.containerEnd(j, r->a); break;
+                case BL_ACTIONS: visitor.actions(j, r->a); break;
+                case BL_VM_CREATE: visitor.vmCreate(j, r->a, r->b); break;
+                case BL_VM_SHUTDOWN: visitor.vmShutdown(j, r->a); break;
+                case BL_ASSIGN: visitor.assign(j, r->a, r->b); break;
+                case BL_END: visitor.end(); return;
+                case BL_TIME: j += r->a; break;
+                default: check(false, "Unknown binary log record kind " + to_string(r->kind()));
+            }
+        }
+        visitor.end();
+    }
+
+private:
+    static const long RELEASE_CHUNK = 64 << 20;
+
+    MappedFile file;
+    const BinLogHeader* header;
+};
+
+/// @brief Writer of the checker log in either text or binary format.
+class LogWriter : public LogVisitor
+{
+public:
+    LogWriter(const string& filename, bool binary): binary(binary), last_time(0), idle_time(-1), idle_cnt(0), idle_empty(0)
+    {
+        f = fopen(filename.c_str(), binary ? "wb" : "w");
+        check(f != nullptr, "Cannot open checker log " + filename);
+        setvbuf(f, nullptr, _IOFBF, 1 << 20);
+    }
+
+    LogWriter(const LogWriter&) = delete;
+    LogWriter& operator=(const LogWriter&) = delete;
+
+    ~LogWriter()
+    {
+        fclose(f);
+    }
+
+    void begin(int t)
+    {
+        if (binary)
+        {
+            BinLogHeader header;
+            memcpy(header.magic, BINLOG_MAGIC, sizeof(BINLOG_MAGIC));
+            header.version = BINLOG_VERSION;
+            header.record_size = sizeof(BinLogRecord);
+            header.t = t;
+            fwrite(&header, sizeof(header), 1, f);
+        }
+        else
+            fprintf(f, "%d\n", t);
+    }
+
+    void step(int j, int e, int cnt)
+    {
+        if (binary)
+        {
+            flushIdle();
+            if (e == 0)
+            {
+                // Idle groups are held back so that their empty steps can be folded into one record
+                idle_time = j;
+                idle_cnt = cnt;
+                idle_empty = 0;
+            }
+            else
+                record(BL_STEP, j, e, cnt);
+        }
+        else if (e == 0)
+            fprintf(f, "0 %d\n", cnt);
+        else
+            fprintf(f, "%d\n", e);
+    }
+
+    void containerNew(int j, int id, int cpu, int mem)
+    {
+        if (binary)
+            record(BL_CONT_NEW, j, id, cpu, mem);
+        else
+            fprintf(f, "1 %d %d %d\n", id, cpu, mem);
+    }
+
+    void containerEnd(int j, int id)
+    {
+        if (binary)
+            record(BL_CONT_END, j, id);
+        else
+            fprintf(f, "2 %d\n", id);
+    }
+
+    void actions(int j, int a)
+    {
+        if (binary)
+        {
+            if (idle_time != -1 && a == 0 && j == idle_time + idle_empty)
+                idle_empty++;
+            else
+                record(BL_ACTIONS, j, a);
+        }
+        else
+            fprintf(f, "%d\n", a);
+    }
+
+    void vmCreate(int j, int id, int vm_type)
+    {
+        if (binary)
+            record(BL_VM_CREATE, j, id, vm_type);
+        else
+            fprintf(f, "1 %d %d\n", id, vm_type);
+    }
+
+    void vmShutdown(int j, int id)
+    {
+        if (binary)
+            record(BL_VM_SHUTDOWN, j, id);
+        else
+            fprintf(f, "2 %d\n", id);
+    }
+
+    void assign(int j, int id_cont, int id_vm)
+    {
+        if (binary)
+            record(BL_ASSIGN, j, id_cont, id_vm);
+        else
+            fprintf(f, "3 %d %d\n", id_cont, id_vm);
+    }
+
+    void end()
+    {
+        if (binary)
+            record(BL_END, last_time, 0);
+        else
+            fprintf(f, "0\n");
+        fflush(f);
+    }
+
+private:
+    FILE* f;
+    bool binary;
+    int last_time;
+    int idle_time, idle_cnt, idle_empty;
+
+    void flushIdle()
+    {
+        if (idle_time == -1)
+            return;
+        int j = idle_time;
+        idle_time = -1;
+        put(BL_STEP, j, 0, idle_cnt, idle_empty);
+        if (idle_empty > 0)
+            last_time = j + idle_empty - 1;
+    }
+
+    void record(uint32_t kind, int j, int a, int b = 0, int c = 0)
+    {
+        flushIdle();
+        put(kind, j, a, b, c);
+    }
+
+    void put(uint32_t kind, int j, int a, int b, int c)
+    {
+        int dt = j - last_time;
+        if (dt > BINLOG_MAX_DT)
+        {
+            BinLogRecord skip = {BL_TIME, dt, 0};
+            fwrite(&skip, sizeof(skip), 1, f);
+            dt = 0;
+        }
+        check(c >= 0 && c <= BINLOG_MAX_C, "Value does not fit into binary log record: " + to_string(c));
+        BinLogRecord r = {kind | ((uint32_t)dt << 4) | ((uint32_t)c << 8), a, b};
+        fwrite(&r, sizeof(r), 1, f);
+        last_time = j;
+    }
+};
+
+/// @brief Forward every callback to two visitors. Null visitors are skipped.
+template<class A, class B>
+class LogTee : public LogVisitor
+{
+public:
+    LogTee(A* a, B* b): a(a), b(b) {}
+
+    void begin(int t) { if (a) a->begin(t); if (b) b->begin(t); }
+    void step(int j, int e, int cnt) { if (a) a->step(j, e, cnt); if (b) b->step(j, e, cnt); }
+    void containerNew(int j, int id, int cpu, int mem) { if (a) a->containerNew(j, id, cpu, mem); if (b) b->containerNew(j, id, cpu, mem); }
+    void containerEnd(int j, int id) { if (a) a->containerEnd(j, id); if (b) b->containerEnd(j, id); }
+    void actions(int j, int cnt) { if (a) a->actions(j, cnt); if (b) b->actions(j, cnt); }
+    void vmCreate(int j, int id, int vm_type) { if (a) a->vmCreate(j, id, vm_type); if (b) b->vmCreate(j, id, vm_type); }
+    void vmShutdown(int j, int id) { if (a) a->vmShutdown(j, id); if (b) b->vmShutdown(j, id); }
+    void assign(int j, int id_cont, int id_vm) { if (a) a->assign(j, id_cont, id_vm); if (b) b->assign(j, id_cont, id_vm); }
+    void end() { if (a) a->end(); if (b) b->end(); }
+
+private:
+    A* a;
+    B* b;
+};
@@ -0,0 +1,124 @@
+import argparse
+import concurrent.futures
+import math
+import os
+import statistics
+
+from sweep import load_cache, parse_seeds, run_key, run_seed, save_cache
+from test_cache import DEFAULT_CACHE_DIR, TestCache
+
+# A/B comparison of two solutions on the same seeds. Runs of both solutions are interleaved,
+# so that machine noise affects them equally, and scores are compared seed by seed.
+# Both runs of a seed get the same test and the same checker arguments (the harness passes the checker no per-run
+# paths), so the checker draws the same random stream for A and B and only the solutions differ.
+
+# Two-sided 95% quantiles of Student's t distribution for 1..30 degrees of freedom
+T_QUANTILES = [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+               2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+               2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042]
+
+def t_quantile(df):
+    return T_QUANTILES[df - 1] if df <= len(T_QUANTILES) else 1.96
+
+def paired(values):
+    """Mean of the paired differences with its 95% confidence interval."""
+    mean = statistics.mean(values)
+    if len(values) < 2:
+        return mean, -math.inf, math.inf
+    half = t_quantile(len(values) - 1) * statistics.stdev(values) / math.sqrt(len(values))
+    return mean, mean - half, mean + half
+
+def run_both(solutions, seeds, *, jobs=None, cache_file=None, **run_args):
+    cache = load_cache(cache_file)
+    # Same keys as sweep.py, so A and B differ whenever their command lines do
+    keys = [{seed: run_key(solution, seed, **run_args) for seed in seeds} for solution in solutions]
+    results = [{}, {}]
+    todo = []
+    # Interleave the runs: A and B of the same seed are started next to each other
+    for seed in seeds:
+        for i in range(2):
+            if keys[i][seed] in cache:
+                results[i][seed] = cache[keys[i][seed]]
+            else:
+                todo.append((i, seed))
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=jobs or os.cpu_count()) as pool:
+        futures = {pool.submit(run_seed, solutions[i], seed, **run_args): i for i, seed in todo}
+        for future in concurrent.futures.as_completed(futures):
+            i = futures[future]
+            result = future.result()
+            results[i][result["seed"]] = result
+            if result["verdict"] == "ok":
+                cache[keys[i][result["seed"]]] = result
+
+    save_cache(cache_file, cache)
+    return results
+
+def main():
+    parser = argparse.ArgumentParser(description="Compares two solutions on the same seeds with paired statistics. "
+                                                 "Exits with code 1 if the candidate is significantly worse than the baseline.")
+
+    parser.add_argument("--baseline",   required=True,             help='Command of the baseline solution (A).')
+    parser.add_argument("--candidate",  required=True,             help='Command of the candidate solution (B).')
+    parser.add_argument("--seeds",      default = "1-20",          help='Seeds to run: ranges and lists, e.g. \'1-100\' or \'1,5,10-20\' (default: %(default)s).')
+    parser.add_argument("--jobs",       type=int,                  help='How many runs are executed at the same time (default: number of CPUs).')
+    parser.add_argument("--time_limit", default = 30, type=int,    help='How long a solution is allowed to run on one seed (in seconds).')
+    parser.add_argument("--harness",    default = "./harness",     help='Path to the harness executable (default: \'%(default)s\').')
+    parser.add_argument("--checker",    default = "./checker",     help='Path to the checker executable (default: \'%(default)s\').')
+    parser.add_argument("--generator",  default = "./generator",   help='Path to the generator executable (default: \'%(default)s\').')
+    parser.add_argument("--cache",      default = "",              help='File with cached results shared with sweep.py (default: no caching).')
+    parser.add_argument("--test_cache", default = DEFAULT_CACHE_DIR, help='Directory of the generated test cache, \'\' to generate tests on every run (default: \'%(default)s\').')
+    parser.add_argument("--quiet",      action="store_true",       help="Print only the summary.")
+    args = parser.parse_args()
+
+    seeds = parse_seeds(args.seeds)
+    test_cache = TestCache(args.test_cache, args.generator) if args.test_cache else None
+    try:
+        a, b = run_both([args.baseline, args.candidate], seeds, jobs=args.jobs, cache_file=args.cache or None,
+                        harness=args.harness, generator=args.generator, checker=args.checker, time_limit=args.time_limit, test_cache=test_cache)
+    finally:
+        if test_cache is not None:
+            test_cache.release()
+
+    deltas, rel_deltas, time_deltas, rss_deltas = [], [], [], []
+    wins = losses = ties = 0
+    failed = []
+    candidate_failed = False
+    for seed in seeds:
+        ra, rb = a[seed], b[seed]
+        if ra["verdict"] != "ok" or rb["verdict"] != "ok":
+            failed.append(seed)
+            candidate_failed |= rb["verdict"] != "ok"
+            if not args.quiet:
+                print(f"seed {seed:>6}: A {ra['verdict']} {ra['message']} / B {rb['verdict']} {rb['message']}")
+            continue
+        delta = rb["score"] - ra["score"]
+        deltas.append(delta)
+        rel_deltas.append(delta / ra["score"] * 100 if ra["score"] else 0)
+        time_deltas.append(rb["wall_s"] - ra["wall_s"])
+        rss_deltas.append(rb["max_rss_kb"] - ra["max_rss_kb"])
+        wins += delta > 0
+        losses += delta < 0
+        ties += delta == 0
+        if not args.quiet:
+            print(f"seed {seed:>6}: A {ra['score']:>8} B {rb['score']:>8} delta {delta:>+8} ({rel_deltas[-1]:+6.2f}%) "
+                  f"time {ra['wall_s']:6.2f}s -> {rb['wall_s']:6.2f}s")
+
+    print()
+    print(f"Seeds: {len(seeds)}, compared: {len(deltas)}, failed: {len(failed)}")
+    if not deltas:
+        exit(1)
+    print(f"Wins/losses/ties of B: {wins}/{losses}/{ties}")
+    for name, values, unit in (("score", deltas, ""), ("score %", rel_deltas, "%"), ("wall time", time_deltas, "s"), ("max rss", rss_deltas, "KB")):
+        mean, low, high = paired(values)
+        print(f"{name:>10} delta: {mean:+12.3f}{unit}  95% CI [{low:+.3f}, {high:+.3f}]")
+
+    mean, low, high = paired(deltas)
+    if high < 0 or candidate_failed:
+        print("Significant regression of the candidate." if high < 0 else "The candidate failed on some seeds.")
+        exit(1)
+    if low > 0:
+        print("Significant improvement of the candidate.")
+
+if __name__ == "__main__":
+    main()
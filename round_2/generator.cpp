@@ -4,59 +4,53 @@
 #include <map>
 #include <set>
 #include <tuple>
+#include <queue>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <assert.h>
 #include "algotester_generator.h"
+#include "vm_catalog.h"
 
 using namespace std;
 
-const int T = (int) 2e7;
-const int MAX_CPU = 25600; // changed max cpu to 64 * 400
-const int MAX_MEM = 524288; // changed max memory to 512 * 1024
+int T = (int) 2e7; // bound of the request times, raised for tests with large tenants
 const int MIN_DURATION = 21;
 AlgotesterGenerator gen;
 
-void get_vm_types(int m_set, vector<int> &cpu, vector<int> &mem, vector<double> &price) {
-    if (m_set == 1) {
-        cpu = {3164, 4760, 6356, 9548, 12740, 19124, 25508, 38276, 51044};
-        mem = {59794, 90596, 121398, 185624, 249849, 378299, 506750, 763651, 1020552};
-        price = {456, 684, 911, 1367, 1823, 2734, 3646, 5469, 7292};
-    } else if (m_set == 2) {
-        cpu = {
-            376, 376, 772, 772, 772, 1568, 1568, 1568, 3164, 3164, 3164, 3164, 4760, 4760,
-            6356, 6356, 6356, 6356, 9548, 9548, 9548, 11144, 12740, 12740, 12740, 19124, 19124,
-            19124, 19124, 22316, 25508, 25508, 25508, 35084, 38276, 38276, 38276, 38276, 41468,
-            51044, 51044, 51044
-        };
-
-        mem = {
-            665, 1433, 1433, 3218, 7015, 3218, 7015, 14263, 7015, 14263, 29414, 59794, 44815,
-            90596, 14263, 29414, 59794, 121398, 44815, 90596, 185624, 342173, 59794, 121398,
-            249849, 90596, 185624, 378299, 956327, 691398, 121398, 249849, 506750, 169567,
-            185624, 378299, 763651, 1919706, 1464108, 249849, 506750, 1020552
-        };
+// Workload scenarios of parameterized tests (scenario=<name>)
+enum Scenario { BURST, DIURNAL, FLASH_CROWD, LONG_TAIL, MEM_HEAVY, CPU_HEAVY, FRAGMENTATION };
+const map<string, Scenario> SCENARIO_NAMES = {
+    {"burst", BURST}, {"diurnal", DIURNAL}, {"flash", FLASH_CROWD}, {"longtail", LONG_TAIL},
+    {"memheavy", MEM_HEAVY}, {"cpuheavy", CPU_HEAVY}, {"fragment", FRAGMENTATION}
+};
+const int DAY = 60 * 60 * 24;
+Scenario scenario = BURST;
+vector<pair<int, int>> flash_windows; // [start, end) of flash crowds, shared by all tenants
+vector<int> catalog_cpu, catalog_mem; // VM types of the test, used by the fragmentation scenario
 
-        price = {
-                86,    143,    229,    314,    486,    457,    629,    971,    943,   1300,
-              2029,   4558,   5157,   6836,   1871,   2600,   6876,   9115,   6329,  10314,
-             13673,  20471,   8429,  13753,  18230,  12657,  20629,  27344,  68113,  40943,
-             16857,  27505,  36459,  28900,  32311,  41258,  54689, 136226,  94486,  43082,
-             55011,  72918
-        };
-    }
-    assert(cpu.size() == mem.size() && cpu.size() == price.size());
-}
-
-void generate_resource_req(int n, int *rc, int *rm) {
+void generate_resource_req(AlgotesterGenerator &gen, int start, int n, int *rc, int *rm) {
     double cpu_mean[2] = {0, 3.0};
     double cpu_sd[2] = {1.5, 1.3};
 
-    for (int i = 1; i <= n; i++) {
+    // The xoshiro backend draws the CPU normals of all requests in bulk, mt keeps the draw order of existing tests
+    bool bulk = gen.getBackend() == AlgotesterGenerator::Backend::XOSHIRO256PP;
+    vector<double> cpu_normal(bulk ? n : 0);
+    gen.fillNormal(cpu_normal, 0, 1);
+
+    for (int i = start; i < start + n; i++) {
         double cpu;
         if (gen.randInt(4) == 0) {
             cpu = 12.0;
         } else {
             int dist_group = gen.randInt(100) >= 75;
-            int cpu_group = (int) (fabs(gen.randDoubleNormal(cpu_mean[dist_group], cpu_sd[dist_group]) - cpu_mean[dist_group]) + cpu_mean[dist_group]);
+            double normal = bulk ? cpu_mean[dist_group] + cpu_sd[dist_group] * cpu_normal[i - start]
+                                 : (double) gen.randDoubleNormal(cpu_mean[dist_group], cpu_sd[dist_group]);
+            int cpu_group = (int) (fabs(normal - cpu_mean[dist_group]) + cpu_mean[dist_group]);
             if (cpu_group > 6)
                 cpu_group = 6;
             
@@ -99,9 +93,20 @@ void generate_resource_req(int n, int *rc, int *rm) {
             }
         }
         
+        if (scenario == FRAGMENTATION) {
+            // Just over a half of some VM type: two such containers never fit into it together
+            cpu = min(64, catalog_cpu[gen.randInt(catalog_cpu.size())] / 800 + 1);
+        }
+
         int mem;
         int rnd = gen.randInt(3);
-        if (!rnd) {
+        if (scenario == FRAGMENTATION) {
+            mem = rnd ? cpu * 2 : min(512, catalog_mem[gen.randInt(catalog_mem.size())] / 2048 + 1);
+        } else if (scenario == MEM_HEAVY && rnd) {
+            mem = cpu >= 2 ? cpu * 8 - gen.randInt(9) : cpu * 8;
+        } else if (scenario == CPU_HEAVY && rnd) {
+            mem = cpu * (gen.randInt(2) + 1);
+        } else if (!rnd) {
             mem = cpu * 2;
         } else if (rnd == 1 && cpu >= 2) {
             mem = cpu * 8 - gen.randInt(9);
@@ -130,7 +135,7 @@ double get_exp(double x, double w) {
     return log(1 - x) / (-w);
 }
 
-void generate_tenant(int tenant_id, int start, int n, int *rt, int *rd, int *rten) {
+void generate_tenant(AlgotesterGenerator &gen, int tenant_id, int start, int n, int *rt, int *rd, int *rten) {
     int start_time = gen.randInt(0, 60 * 60 * 24);
 
     double diff_lambda = 0.001;
@@ -139,36 +144,66 @@ void generate_tenant(int tenant_id, int start, int n, int *rt, int *rd, int *rte
     double dur_sd[2] = {(double) gen.randDouble(15, 35), (double) gen.randDouble(20, 40)};
     double dur_lambda[2] = {0.0007, 0.00003};
 
+    // The xoshiro backend draws the arrival gaps and the first duration of every request in bulk,
+    // mt keeps the draw order of existing tests
+    bool bulk = gen.getBackend() == AlgotesterGenerator::Backend::XOSHIRO256PP;
+    vector<double> gap_kind(bulk ? n : 0), short_gap(bulk ? n : 0), long_gap(bulk ? n : 0), dur_normal(bulk ? n : 0);
+    gen.fillDouble(gap_kind);
+    gen.fillNormal(short_gap, 0, 4);
+    gen.fillExponential(long_gap, diff_lambda);
+    gen.fillNormal(dur_normal, dur_mean[1], dur_sd[1]);
+
     for (int i = start; i < start + n; i++) {
         int prev_time = i == start ? start_time : rt[i - 1];
 
         int diff;
-        int rnd = gen.randInt(10);
+        int rnd = bulk ? gap_kind[i - start] * 10 : gen.randInt(10);
         if (rnd < 5) {
-            diff = fabs(gen.randDoubleNormal(0, 4));
+            diff = fabs(bulk ? short_gap[i - start] : gen.randDoubleNormal(0, 4));
         } else {
-            diff = 10 + get_exp(gen.randDouble(), diff_lambda);
+            diff = 10 + (bulk ? long_gap[i - start] : get_exp(gen.randDouble(), diff_lambda));
+        }
+        if (scenario == DIURNAL) {
+            // Arrival rate follows a daily wave between 0.2 and 1.8 of the average
+            diff /= 1 + 0.8 * sin(2 * M_PI * prev_time / DAY);
+        } else if (scenario == FLASH_CROWD) {
+            for (auto [from, to] : flash_windows) {
+                if (prev_time >= from && prev_time < to) {
+                    diff = fabs(gen.randDoubleNormal(0, 1));
+                    break;
+                }
+            }
         }
         rt[i] = prev_time + diff;
         assert(rt[i] >= 0 && rt[i] < T && diff >= 0);
         
         int dur;
+        bool first = true;
         do
         {
-            rnd = gen.randInt(100);
-	    rnd = 50;
-            if (rnd < 10) {
-                dur = dur_mean[1] + dur_sd[1] + get_exp(0, dur_lambda[0]) + get_exp(gen.randDouble(), dur_lambda[1]);
-            } else if (rnd < 25) {
-                dur = dur_mean[1] + dur_sd[1] + get_exp(gen.randDouble(), dur_lambda[0]);
-            } else if (rnd < 70) {
-                dur = gen.randDoubleNormal(dur_mean[1], dur_sd[1]) + 0.5;
+            if (bulk && first && scenario != LONG_TAIL) {
+                // The normal branch taken outside of the long tail scenario, from the bulk draw
+                dur = dur_normal[i - start] + 0.5;
             } else {
-                dur = gen.randDoubleNormal(dur_mean[0], dur_sd[0]) + 0.5;
+                rnd = gen.randInt(100);
+                if (scenario != LONG_TAIL)
+                    rnd = 50;
+                if (rnd < 10) {
+                    dur = dur_mean[1] + dur_sd[1] + get_exp(0, dur_lambda[0]) + get_exp(gen.randDouble(), dur_lambda[1]);
+                } else if (rnd < 25) {
+                    dur = dur_mean[1] + dur_sd[1] + get_exp(gen.randDouble(), dur_lambda[0]);
+                } else if (rnd < 70) {
+                    dur = gen.randDoubleNormal(dur_mean[1], dur_sd[1]) + 0.5;
+                } else {
+                    dur = gen.randDoubleNormal(dur_mean[0], dur_sd[0]) + 0.5;
+                }
             }
+            first = false;
 
             if (dur < 1)
                 dur = gen.randInt(60) + 1;
+            if (scenario == FRAGMENTATION)
+                dur = (i - start) % 2 ? MIN_DURATION + gen.randInt(20) : dur * 4;
         } while(dur < MIN_DURATION);
 
         rd[i] = dur;
@@ -178,7 +213,143 @@ void generate_tenant(int tenant_id, int start, int n, int *rt, int *rd, int *rte
     }
 }
 
+// Buffered output of the test
+class FastWriter {
+public:
+    FastWriter() : pos(0) {}
+    ~FastWriter() { flush(); }
+
+    void write(long long x) {
+        if (pos + 24 > sizeof(buf))
+            flush();
+        if (x < 0) {
+            buf[pos++] = '-';
+            x = -x;
+        }
+        char tmp[20];
+        int len = 0;
+        do {
+            tmp[len++] = '0' + x % 10;
+            x /= 10;
+        } while (x);
+        while (len)
+            buf[pos++] = tmp[--len];
+    }
+
+    void write(int x) {
+        write((long long) x);
+    }
+
+    void write(char c) {
+        if (pos == sizeof(buf))
+            flush();
+        buf[pos++] = c;
+    }
+
+    // Values separated by spaces and followed by a newline
+    template<class T, class... Rest>
+    void line(T first, Rest... rest) {
+        write(first);
+        ((write(' '), write(rest)), ...);
+        write('\n');
+    }
+
+    void flush() {
+        fwrite(buf, 1, pos, stdout);
+        pos = 0;
+    }
+
+private:
+    char buf[1 << 16];
+    size_t pos;
+};
+
+// Order of the requests by time: k-way merge of the tenants, whose requests are already sorted by time.
+// Requests with equal times are taken in the order of tenants.
+vector<int> merge_tenants(const vector<int> &tenant_sizes, const vector<int> &rt) {
+    typedef pair<int, int> Head; // (time, index of the request)
+    priority_queue<Head, vector<Head>, greater<Head>> heads;
+    vector<int> tenant_end(rt.size());
+    int start = 1;
+    for (int sz : tenant_sizes) {
+        tenant_end[start] = start + sz;
+        heads.push({rt[start], start});
+        start += sz;
+    }
+
+    vector<int> order;
+    order.reserve(rt.size());
+    while (!heads.empty()) {
+        int j = heads.top().second;
+        heads.pop();
+        order.push_back(j);
+        if (j + 1 < tenant_end[j]) {
+            tenant_end[j + 1] = tenant_end[j];
+            heads.push({rt[j + 1], j + 1});
+        }
+    }
+    return order;
+}
+
+// Cost model of synthetic VM catalogs
+struct CatalogModel {
+    int types = 0; // 0 - use a predefined catalog
+    double cpu_price = 0.097; // per unit of cpu, fitted to the predefined catalogs
+    double mem_price = 0.074; // per unit of memory
+    double noise = 0.05; // standard deviation of the multiplicative price noise
+    double dominated = 0.1; // share of types priced above a type with at least the same resources
+    double near_dominated = 0.1; // share of types priced slightly below such a type
+};
+
+// Synthetic catalog of model.types VM types. The last type always fits the largest container.
+void generate_vm_types(const CatalogModel &model, vector<int> &cpu, vector<int> &mem, vector<double> &price) {
+    cpu.clear(), mem.clear(), price.clear();
+    for (int i = 0; i < model.types; i++) {
+        int cores = i + 1 < model.types ? gen.randLogUniform(128) : 128;
+        double mem_per_core = i + 1 < model.types ? exp(gen.randDouble(log(0.5), log(32))) : 8;
+        // Like in the predefined catalogs, part of the resources is reserved by the host
+        cpu.push_back(max(376, cores * 400 - 36));
+        mem.push_back(max(665, (int) (cores * mem_per_core * 1024) - 1000 * cores / 8));
+        double cost = (model.cpu_price * cpu.back() + model.mem_price * mem.back()) * exp(gen.randDoubleNormal(0, model.noise));
+        price.push_back(max(1.0, round(cost)));
+    }
+    for (int i = 0; i + 1 < model.types; i++) {
+        double kind = gen.randDouble();
+        if (kind >= model.dominated + model.near_dominated)
+            continue;
+        // The cheapest type with at least the same resources
+        int j = -1;
+        for (int k = 0; k < model.types; k++)
+            if (k != i && cpu[k] >= cpu[i] && mem[k] >= mem[i] && (j == -1 || price[k] < price[j]))
+                j = k;
+        if (j == -1)
+            continue;
+        double factor = kind < model.dominated ? gen.randDouble(1, 1.1) : gen.randDouble(0.97, 1);
+        price[i] = max(1.0, round(price[j] * factor));
+    }
+    assert(cpu.back() >= MAX_CPU && mem.back() >= MAX_MEM);
+}
+
+// Seed of the random stream of one tenant (splitmix64 of the base seed and the tenant id)
+unsigned long long tenant_seed(unsigned long long base, int tenant_id) {
+    unsigned long long z = base + (unsigned long long) tenant_id * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
 int main(int argc, char* argv[]) {
+    // threads=<count> only controls the speed of generation, so it does not take part in the seed
+    int threads = max(1u, thread::hardware_concurrency());
+    vector<char*> args;
+    for (int i = 0; i < argc; i++) {
+        if (i > 0 && strncmp(argv[i], "threads=", 8) == 0)
+            threads = max(1, atoi(argv[i] + 8));
+        else
+            args.push_back(argv[i]);
+    }
+    argc = args.size();
+    argv = args.data();
     gen = AlgotesterGenerator(argc, argv);
 
     // Processing arguments
@@ -187,62 +358,160 @@ int main(int argc, char* argv[]) {
     int m_set = n >= 9000 ? 2 : 1; // VM types set. If m == 1 or m == 2 it will generate predefined vm types;
     int d = 40; // VMs creation delay
 
+    // Optional workload parameters after the seed: n=<requests> tenants=<count> d=<delay> catalog=<1|2> rng=<mt|xoshiro> threads=<count>
+    //                                           scenario=<burst|diurnal|flash|longtail|memheavy|cpuheavy|fragment>
+    // Synthetic VM catalog: types=<count> cpu_price=<price> mem_price=<price> price_noise=<sd> dominated=<share> near_dominated=<share>
+    CatalogModel model;
+    bool custom = false;
+    int catalog = 0;
+    AlgotesterGenerator::Backend backend = AlgotesterGenerator::Backend::MT19937_64;
+    for (int i = 2; i < argc; i++) {
+        string arg = gen.getArg<string>(i);
+        size_t eq = arg.find('=');
+        assert(eq != string::npos);
+        string key = arg.substr(0, eq);
+        custom = true;
+        if (key == "rng") {
+            assert(arg.substr(eq + 1) == "xoshiro" || arg.substr(eq + 1) == "mt");
+            backend = arg.substr(eq + 1) == "xoshiro" ? AlgotesterGenerator::Backend::XOSHIRO256PP : AlgotesterGenerator::Backend::MT19937_64;
+            continue;
+        }
+        if (key == "scenario") {
+            assert(SCENARIO_NAMES.count(arg.substr(eq + 1)));
+            scenario = SCENARIO_NAMES.at(arg.substr(eq + 1));
+            continue;
+        }
+        double value = stod(arg.substr(eq + 1));
+        if (key == "types") {
+            model.types = value;
+        } else if (key == "cpu_price") {
+            model.cpu_price = value;
+        } else if (key == "mem_price") {
+            model.mem_price = value;
+        } else if (key == "price_noise") {
+            model.noise = value;
+        } else if (key == "dominated") {
+            model.dominated = value;
+        } else if (key == "near_dominated") {
+            model.near_dominated = value;
+        } else if (key == "n") {
+            n = value;
+        } else if (key == "tenants") {
+            tenants = value;
+        } else if (key == "d") {
+            d = value;
+        } else {
+            assert(key == "catalog");
+            catalog = value;
+        }
+    }
+    if (custom)
+        m_set = catalog ? catalog : n >= 9000 ? 2 : 1;
+    assert(n >= 1 && tenants >= 1 && tenants <= n && d >= 0 && (m_set == 1 || m_set == 2) && model.types >= 0);
+
     
     // Generating VM types to be used
     vector<int> cpu, mem;
     vector<double> price;
-    get_vm_types(m_set, cpu, mem, price);
+    if (model.types > 0)
+        generate_vm_types(model, cpu, mem, price);
+    else
+        get_vm_types(m_set, cpu, mem, price);
+    catalog_cpu = cpu;
+    catalog_mem = mem;
 
     
     // Generating tenants sizes
-    int rt[n + 5], rd[n + 5], rten[n + 5], rc[n + 5], rm[n + 5];
-    memset(rm, -1, sizeof rm);
+    vector<int> rt(n + 5), rd(n + 5), rten(n + 5), rc(n + 5), rm(n + 5, -1);
     vector<int> tenant_sizes(tenants, 0);
     int total = 0;
     for (int i = 0; i < tenants; i++) {
         int sz = i + 1 < tenants ? gen.randBiasedInt(n - total + 1, -(tenants - i - 1)) : n - total;
-        if (sz == 0)
-            sz = 1;
+        // Every tenant gets at least one request, so the sizes drawn later must leave one for each remaining tenant
+        sz = min(max(sz, 1), n - total - (tenants - i - 1));
         tenant_sizes[i] = sz;
         total += sz;
     }
 
     assert(total == n);
     gen.shuffle(tenant_sizes);
+
+    // Arrivals of a tenant are on average about 500 steps apart, so the time bound grows with the largest tenant
+    long long horizon = DAY + 1000LL * *max_element(tenant_sizes.begin(), tenant_sizes.end());
+    if (horizon > INT_MAX / 2) {
+        fprintf(stderr, "n=%d with tenants=%d gives a tenant of %d requests, whose times do not fit in int, use more tenants\n",
+                n, tenants, *max_element(tenant_sizes.begin(), tenant_sizes.end()));
+        return 1;
+    }
+    T = max<long long>(T, horizon);
     
     
     // Filling tenants
-    total = 0;
-    for (int i = 0; i < tenants; i++) {
-        int sz = tenant_sizes[i];
-        generate_tenant(i + 1, total + 1, sz, rt, rd, rten);
-        total += sz;
+    vector<int> tenant_start(tenants + 1, 1);
+    for (int i = 0; i < tenants; i++)
+        tenant_start[i + 1] = tenant_start[i] + tenant_sizes[i];
+    assert(tenant_start[tenants] == n + 1);
+
+    if (custom) {
+        // Every tenant draws from its own stream, so tenants are generated in parallel
+        // and the test does not depend on the number of threads
+        unsigned long long base_seed = gen.randUInt();
+        if (scenario == FLASH_CROWD) {
+            // A few short windows over the expected span of the test, in which every tenant bursts
+            long long span = DAY + (long long) n / tenants * 500;
+            int windows = gen.randInt(3, 6);
+            for (int i = 0; i < windows; i++) {
+                int from = gen.randInt(0, span);
+                flash_windows.push_back({from, from + (int) gen.randInt(300, 900)});
+            }
+        }
+        atomic<int> next_tenant(0);
+        auto worker = [&]() {
+            for (int i; (i = next_tenant++) < tenants; ) {
+                AlgotesterGenerator tenant_gen(tenant_seed(base_seed, i + 1), backend);
+                generate_tenant(tenant_gen, i + 1, tenant_start[i], tenant_sizes[i], rt.data(), rd.data(), rten.data());
+                generate_resource_req(tenant_gen, tenant_start[i], tenant_sizes[i], rc.data(), rm.data());
+            }
+        };
+        vector<thread> pool;
+        for (int i = 1; i < min(threads, tenants); i++)
+            pool.emplace_back(worker);
+        worker();
+        for (auto &t : pool)
+            t.join();
+    } else {
+        for (int i = 0; i < tenants; i++)
+            generate_tenant(gen, i + 1, tenant_start[i], tenant_sizes[i], rt.data(), rd.data(), rten.data());
+        generate_resource_req(gen, 1, n, rc.data(), rm.data());
     }
-    assert(total == n);
-    generate_resource_req(n, rc, rm);
 
 
     // Printing test
+    FastWriter out;
     int m = cpu.size();
-    std::cout << m << ' ' << d << '\n';
+    out.line(m, d);
     for (int i = 0; i < m; i++) {
-        std::cout << cpu[i] << ' ' << mem[i] << ' ' << price[i] << '\n';
+        out.line(cpu[i], mem[i], (long long) price[i]); // prices are whole numbers, the checker reads integers
     }
 
     vector<int> order;
-    for (int i = 1; i <= n; i++) {
-        order.push_back(i);
-    }
+    if (custom) {
+        rt.resize(n + 1);
+        order = merge_tenants(tenant_sizes, rt);
+    } else {
+        // Default tests keep the order of equal times produced by the original global sort
+        for (int i = 1; i <= n; i++) {
+            order.push_back(i);
+        }
 
-    sort(order.begin(), order.end(), [&](const int &i, const int &j) {
-        return rt[i] < rt[j];
-    });
+        sort(order.begin(), order.end(), [&](const int &i, const int &j) {
+            return rt[i] < rt[j];
+        });
+    }
 
-    cout << n << '\n';
+    out.line(n);
     for (int i = 0; i < n; i++) {
         int j = order[i];
-        cout << rt[j] << ' ' << i + 1 << ' ' << rc[j] << ' ' << rm[j] << ' ' << rd[j] << '\n';
+        out.line(rt[j], i + 1, rc[j], rm[j], rd[j]);
     }
 }
-
-
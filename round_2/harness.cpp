@@ -0,0 +1,526 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "session_record.h"
+using namespace std;
+
+// Benchmark harness: generates the test, runs checker and solution, scores the result and reports
+// resource usage of every process together with the response latency of the solution as JSON.
+//
+// Usage: ./harness --solution <command> --test_file <path> [--seed <seed>] [--generator ./generator]
+//                  [--checker ./checker] [--scorer ./scorer] [--time_limit 30] [--fused] [--direct]
+//                  [--json <path>] [--log <path>] [--record <path>]
+//
+// The harness sits between the checker and the solution and forwards the protocol in both directions,
+// which lets it time every step: from the moment a checker message is forwarded to the first byte of the answer.
+// --direct connects them with plain pipes instead (no latency statistics).
+// --record saves every forwarded chunk with its time (see session_record.h), to be played back with ./replay.
+
+extern char** environ;
+
+typedef chrono::steady_clock Clock;
+
+struct ProcessStats
+{
+    string name;
+    pid_t pid = -1;
+    Clock::time_point start;
+    double wall = 0;
+    double user = 0;
+    double sys = 0;
+    long max_rss_kb = 0;
+    int exit_code = -1;
+    int signal = 0;
+};
+
+map<string, string> parse_args(int argc, char* argv[])
+{
+    map<string, string> args;
+    for (int i = 1; i < argc; i++)
+    {
+        string key = argv[i];
+        if (key.rfind("--", 0) != 0)
+        {
+            fprintf(stderr, "Unexpected argument %s\n", argv[i]);
+            exit(2);
+        }
+        key = key.substr(2);
+        if (key == "fused" || key == "direct")
+            args[key] = "1";
+        else if (i + 1 < argc)
+            args[key] = argv[++i];
+        else
+        {
+            fprintf(stderr, "Missing value of --%s\n", key.c_str());
+            exit(2);
+        }
+    }
+    return args;
+}
+
+vector<string> split_command(const string& command)
+{
+    vector<string> res;
+    stringstream ss(command);
+    string token;
+    while (ss >> token)
+        res.push_back(token);
+    return res;
+}
+
+/// @brief Move the descriptor out of the range used for redirections and make it close-on-exec.
+int high_fd(int fd)
+{
+    int res = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+    close(fd);
+    return res;
+}
+
+void make_pipe(int fds[2])
+{
+    if (pipe(fds) != 0)
+    {
+        perror("pipe");
+        exit(2);
+    }
+    fds[0] = high_fd(fds[0]);
+    fds[1] = high_fd(fds[1]);
+}
+
+/// @brief Start a process with the given descriptors placed at the given positions.
+void spawn(ProcessStats& stats, const vector<string>& command, const vector<pair<int, int>>& redirects)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    for (auto [fd, target] : redirects)
+        posix_spawn_file_actions_adddup2(&actions, fd, target);
+
+    vector<char*> argv;
+    for (auto& arg : command)
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    stats.start = Clock::now();
+    int res = posix_spawnp(&stats.pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (res != 0)
+    {
+        fprintf(stderr, "Cannot start %s: %s\n", argv[0], strerror(res));
+        exit(2);
+    }
+}
+
+/// @brief Wait for one of the processes and record its resource usage.
+void reap(vector<ProcessStats*> processes, bool block = true)
+{
+    while (true)
+    {
+        int status;
+        struct rusage usage;
+        pid_t pid = wait4(-1, &status, block ? 0 : WNOHANG, &usage);
+        if (pid <= 0)
+            return;
+        for (auto* p : processes)
+        {
+            if (p->pid != pid)
+                continue;
+            p->wall = chrono::duration<double>(Clock::now() - p->start).count();
+            p->user = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+            p->sys = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+            p->max_rss_kb = usage.ru_maxrss;
+            p->exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+            p->signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+            p->pid = -1;
+        }
+        if (block)
+            return;
+    }
+}
+
+string read_all(int fd)
+{
+    string res;
+    char buffer[4096];
+    ssize_t len;
+    while ((len = read(fd, buffer, sizeof(buffer))) > 0)
+        res.append(buffer, len);
+    close(fd);
+    return res;
+}
+
+string trim(const string& s)
+{
+    size_t l = s.find_first_not_of(" \t\r\n");
+    if (l == string::npos)
+        return "";
+    size_t r = s.find_last_not_of(" \t\r\n");
+    return s.substr(l, r - l + 1);
+}
+
+string json_escape(const string& s)
+{
+    string res;
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            res += '\\';
+        if (c == '\n')
+        {
+            res += "\\n";
+            continue;
+        }
+        res += c;
+    }
+    return res;
+}
+
+/// @brief One direction of the forwarded protocol.
+struct Channel
+{
+    int in;
+    int out;
+    string pending;
+    bool eof = false;
+
+    bool done() const { return eof && pending.empty(); }
+};
+
+/// @brief Forward the protocol between checker and solution, timing every response of the solution.
+/// @param record If not null, every chunk read from either side is written to it.
+/// @return False if the time limit was exceeded.
+bool proxy(Channel& to_solution, Channel& to_checker, double time_limit, vector<double>& latencies, SessionWriter* record)
+{
+    auto start = Clock::now();
+    auto deadline = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(time_limit));
+    bool waiting = false;
+    Clock::time_point sent;
+    char buffer[1 << 16];
+
+    for (Channel* c : {&to_solution, &to_checker})
+    {
+        fcntl(c->in, F_SETFL, O_NONBLOCK);
+        fcntl(c->out, F_SETFL, O_NONBLOCK);
+    }
+
+    while (!to_solution.done() || !to_checker.done())
+    {
+        vector<pollfd> fds;
+        vector<pair<Channel*, bool>> roles;
+        for (Channel* c : {&to_solution, &to_checker})
+        {
+            if (!c->eof && c->pending.size() < sizeof(buffer))
+            {
+                fds.push_back({c->in, POLLIN, 0});
+                roles.push_back({c, true});
+            }
+            if (!c->pending.empty())
+            {
+                fds.push_back({c->out, POLLOUT, 0});
+                roles.push_back({c, false});
+            }
+        }
+
+        int timeout = max(0, (int)chrono::duration_cast<chrono::milliseconds>(deadline - Clock::now()).count());
+        if (poll(fds.data(), fds.size(), timeout) <= 0 && Clock::now() >= deadline)
+            return false;
+
+        for (size_t i = 0; i < fds.size(); i++)
+        {
+            if (!fds[i].revents)
+                continue;
+            Channel* c = roles[i].first;
+            if (roles[i].second)
+            {
+                ssize_t len = read(c->in, buffer, sizeof(buffer));
+                if (len > 0)
+                {
+                    if (c == &to_checker && waiting)
+                    {
+                        latencies.push_back(chrono::duration<double>(Clock::now() - sent).count());
+                        waiting = false;
+                    }
+                    c->pending.append(buffer, len);
+                    if (record)
+                        record->write(c == &to_solution ? SESSION_TO_SOLUTION : SESSION_FROM_SOLUTION,
+                            chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count(), buffer, len);
+                }
+                else if (len == 0 || errno != EAGAIN)
+                {
+                    c->eof = true;
+                    if (c->pending.empty())
+                        close(c->out);
+                }
+            }
+            else
+            {
+                ssize_t len = write(c->out, c->pending.data(), c->pending.size());
+                if (len > 0)
+                {
+                    c->pending.erase(0, len);
+                    if (c == &to_solution && c->pending.empty() && !waiting)
+                    {
+                        sent = Clock::now();
+                        waiting = true;
+                    }
+                }
+                else if (len < 0 && errno != EAGAIN)
+                    c->pending.clear();
+                if (c->pending.empty() && c->eof)
+                    close(c->out);
+            }
+        }
+    }
+    return true;
+}
+
+double percentile(const vector<double>& sorted, double q)
+{
+    if (sorted.empty())
+        return 0;
+    size_t i = min(sorted.size() - 1, (size_t)(q * (sorted.size() - 1) + 0.5));
+    return sorted[i];
+}
+
+void print_process(FILE* f, const ProcessStats& p, bool last)
+{
+    fprintf(f, "    \"%s\": {\"wall_s\": %.6f, \"user_s\": %.6f, \"sys_s\": %.6f, \"max_rss_kb\": %ld, \"exit_code\": %d, \"signal\": %d}%s\n",
+        p.name.c_str(), p.wall, p.user, p.sys, p.max_rss_kb, p.exit_code, p.signal, last ? "" : ",");
+}
+
+int main(int argc, char* argv[])
+{
+    signal(SIGPIPE, SIG_IGN);
+    auto args = parse_args(argc, argv);
+    if (!args.count("solution") || !args.count("test_file"))
+    {
+        fprintf(stderr, "Usage: ./harness --solution <command> --test_file <path> [--seed <seed>] [--generator ./generator] "
+                        "[--checker ./checker] [--scorer ./scorer] [--time_limit 30] [--fused] [--direct] [--json <path>] [--log <path>] [--record <path>]\n");
+        return 2;
+    }
+    auto get = [&](string key, string def) { return args.count(key) ? args[key] : def; };
+    string test_file = args["test_file"];
+    double time_limit = atof(get("time_limit", "30").c_str());
+    bool fused = args.count("fused");
+    bool direct = args.count("direct");
+    unique_ptr<SessionWriter> record;
+    if (args.count("record"))
+    {
+        if (direct)
+        {
+            fprintf(stderr, "--record needs the harness between checker and solution, it can not be used with --direct\n");
+            return 2;
+        }
+        record.reset(SessionWriter::open(args["record"]));
+        if (!record)
+        {
+            perror(args["record"].c_str());
+            return 2;
+        }
+    }
+
+    vector<ProcessStats> stats;
+    stats.reserve(4);
+
+    // Generator
+    if (args.count("seed"))
+    {
+        int out = open(test_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (out == -1)
+        {
+            perror(test_file.c_str());
+            return 2;
+        }
+        out = high_fd(out);
+        stats.push_back({"generator"});
+        auto command = split_command(get("generator", "./generator"));
+        command.push_back(args["seed"]);
+        spawn(stats.back(), command, {{out, 1}});
+        close(out);
+        reap({&stats.back()});
+    }
+
+    // Checker and solution
+    string log_file = get("log", "");
+    bool keep_log = !log_file.empty();
+    if (!keep_log)
+    {
+        char name[] = "/tmp/harness_log_XXXXXX";
+        int fd = mkstemp(name);
+        close(fd);
+        log_file = name;
+    }
+    // The checker seeds its random idle steps from its arguments, so the log is passed as a descriptor
+    // with a fixed name: runs of the same test and flags are then reproducible
+    int log_fd = open(log_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (log_fd == -1)
+    {
+        perror(log_file.c_str());
+        return 2;
+    }
+    log_fd = high_fd(log_fd);
+
+    int test_fd = open(test_file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (test_fd == -1)
+    {
+        perror(test_file.c_str());
+        return 2;
+    }
+    test_fd = high_fd(test_fd);
+
+    int checker_to_harness[2], harness_to_checker[2], solution_to_harness[2], harness_to_solution[2], checker_stdout[2];
+    make_pipe(checker_to_harness);
+    make_pipe(solution_to_harness);
+    make_pipe(checker_stdout);
+    if (direct)
+    {
+        // Checker and solution talk to each other without the harness in between
+        harness_to_solution[0] = checker_to_harness[0];
+        harness_to_checker[0] = solution_to_harness[0];
+    }
+    else
+    {
+        make_pipe(harness_to_solution);
+        make_pipe(harness_to_checker);
+    }
+
+    stats.push_back({"checker"});
+    ProcessStats& checker = stats.back();
+    auto checker_command = split_command(get("checker", "./checker"));
+    for (string arg : {"/dev/fd/3", "/dev/fd/4", "0", "0", "/dev/fd/5"})
+        checker_command.push_back(arg);
+    if (fused)
+        checker_command.push_back("--score");
+    spawn(checker, checker_command, {{test_fd, 0}, {checker_stdout[1], 1}, {checker_to_harness[1], 3}, {harness_to_checker[0], 4}, {log_fd, 5}});
+
+    stats.push_back({"solution"});
+    ProcessStats& solution = stats.back();
+    int devnull = high_fd(open("/dev/null", O_WRONLY));
+    spawn(solution, split_command(args["solution"]), {{harness_to_solution[0], 0}, {solution_to_harness[1], 1}, {devnull, 2}});
+
+    close(test_fd);
+    close(log_fd);
+    close(devnull);
+    close(checker_stdout[1]);
+    close(checker_to_harness[1]);
+    close(solution_to_harness[1]);
+    close(harness_to_checker[0]);
+    close(harness_to_solution[0]);
+
+    vector<double> latencies;
+    bool in_time = true;
+    if (direct)
+    {
+        auto deadline = Clock::now() + chrono::duration_cast<Clock::duration>(chrono::duration<double>(time_limit));
+        while ((checker.pid != -1 || solution.pid != -1) && Clock::now() < deadline)
+        {
+            reap({&checker, &solution}, false);
+            usleep(1000);
+        }
+        in_time = checker.pid == -1 && solution.pid == -1;
+    }
+    else
+    {
+        Channel to_solution = {checker_to_harness[0], harness_to_solution[1]};
+        Channel to_checker = {solution_to_harness[0], harness_to_checker[1]};
+        in_time = proxy(to_solution, to_checker, time_limit, latencies, record.get());
+        record.reset();
+        close(checker_to_harness[0]);
+        close(solution_to_harness[0]);
+    }
+    if (!in_time)
+    {
+        for (auto* p : {&checker, &solution})
+            if (p->pid != -1)
+                kill(p->pid, SIGKILL);
+    }
+    string checker_output = read_all(checker_stdout[0]);
+    while (checker.pid != -1 || solution.pid != -1)
+        reap({&checker, &solution});
+
+    // Verdict and score
+    string verdict = "ok", message;
+    long long score = -1;
+    checker_output = trim(checker_output);
+    if (!in_time)
+    {
+        verdict = "timeout";
+        message = "Solution and checker were running for over " + get("time_limit", "30") + " seconds";
+    }
+    else if (fused && !checker_output.empty() && checker_output.find_first_not_of("0123456789") == string::npos)
+        score = atoll(checker_output.c_str());
+    else if (!checker_output.empty())
+    {
+        verdict = "error";
+        message = checker_output;
+    }
+    else
+    {
+        stats.push_back({"scorer"});
+        int scorer_stdout[2];
+        make_pipe(scorer_stdout);
+        auto command = split_command(get("scorer", "./scorer"));
+        command.push_back(test_file);
+        command.push_back(log_file);
+        spawn(stats.back(), command, {{scorer_stdout[1], 1}});
+        close(scorer_stdout[1]);
+        string out = trim(read_all(scorer_stdout[0]));
+        reap({&stats.back()});
+        score = atoll(out.c_str());
+    }
+    if (!keep_log)
+        unlink(log_file.c_str());
+
+    // Report
+    sort(latencies.begin(), latencies.end());
+    double total_latency = 0;
+    for (double x : latencies)
+        total_latency += x;
+
+    FILE* f = args.count("json") ? fopen(args["json"].c_str(), "w") : stdout;
+    if (!f)
+    {
+        perror(args["json"].c_str());
+        return 2;
+    }
+    fprintf(f, "{\n");
+    fprintf(f, "  \"test_file\": \"%s\",\n", json_escape(test_file).c_str());
+    if (args.count("seed"))
+        fprintf(f, "  \"seed\": \"%s\",\n", json_escape(args["seed"]).c_str());
+    fprintf(f, "  \"solution\": \"%s\",\n", json_escape(args["solution"]).c_str());
+    fprintf(f, "  \"verdict\": \"%s\",\n", verdict.c_str());
+    if (!message.empty())
+        fprintf(f, "  \"message\": \"%s\",\n", json_escape(message).c_str());
+    if (score >= 0)
+        fprintf(f, "  \"score\": %lld,\n", score);
+    fprintf(f, "  \"processes\": {\n");
+    for (size_t i = 0; i < stats.size(); i++)
+        print_process(f, stats[i], i + 1 == stats.size());
+    fprintf(f, "  }");
+    if (!direct)
+    {
+        double n = max<size_t>(latencies.size(), 1);
+        fprintf(f, ",\n  \"latency\": {\"steps\": %zu, \"total_s\": %.6f, \"mean_us\": %.3f, \"p50_us\": %.3f, \"p90_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f}",
+            latencies.size(), total_latency, total_latency / n * 1e6, percentile(latencies, 0.5) * 1e6, percentile(latencies, 0.9) * 1e6,
+            percentile(latencies, 0.99) * 1e6, latencies.empty() ? 0 : latencies.back() * 1e6);
+    }
+    fprintf(f, "\n}\n");
+    if (f != stdout)
+        fclose(f);
+
+    return verdict == "ok" ? 0 : 1;
+}
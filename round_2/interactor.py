@@ -13,21 +13,44 @@ def make_fifo(name):
     os.mkfifo(fifo_path)
     return fifo_path
 
-def run_checker(checker_executable, solution_executable, input_file, checker_log, solution_timeout):
-    pipe_checker_to_solution = make_fifo("checker_to_solution")
-    pipe_solution_to_checker = make_fifo("solution_to_checker")
-     
-    checker_args = checker_executable.strip().split(' ') + [pipe_checker_to_solution, pipe_solution_to_checker, "0", "0", checker_log]
+def shm_ring_path(name):
+    shm_dir = "/dev/shm" if os.path.isdir("/dev/shm") else tempfile.gettempdir()
+    return os.path.join(shm_dir, f"shm_ring_{os.getpid()}_{name}")
+
+def run_checker(checker_executable, solution_executable, input_file, checker_log, solution_timeout, binary_log=False, fused=False, transport="fifo", shm_native=False, shm_shim="./shm_shim"):
     solution_args = solution_executable.strip().split(' ')
+    if transport == "shm":
+        channel_checker_to_solution = shm_ring_path("checker_to_solution")
+        channel_solution_to_checker = shm_ring_path("solution_to_checker")
+        if shm_native:
+            solution_args += ["--shm", channel_checker_to_solution, channel_solution_to_checker]
+        else:
+            solution_args = shm_shim.strip().split(' ') + [channel_checker_to_solution, channel_solution_to_checker] + solution_args
+    else:
+        channel_checker_to_solution = make_fifo("checker_to_solution")
+        channel_solution_to_checker = make_fifo("solution_to_checker")
+
+    checker_args = checker_executable.strip().split(' ') + [channel_checker_to_solution, channel_solution_to_checker, "0", "0", checker_log]
+    if binary_log:
+        checker_args.append("--binary-log")
+    if fused:
+        checker_args.append("--score")
+    if transport == "shm":
+        checker_args.append("--shm")
 
     print_details()
     print_details(f"Starting checker. Command: <{' '.join(checker_args)}>.")
     checker_process = subprocess.Popen(checker_args, stdin=open(input_file, "r"), stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
- 
-    with open(pipe_checker_to_solution, 'r') as pipe_checker_to_solution_r:
-        with open(pipe_solution_to_checker, 'w') as pipe_solution_to_checker_w:
-            print_details(f"Starting solution. Command: <{' '.join(solution_args)}>.")
-            solution_process = subprocess.Popen(solution_args, stdin=pipe_checker_to_solution_r, stdout=pipe_solution_to_checker_w, stderr=subprocess.PIPE, text=True)
+
+    if transport == "shm":
+        # The checker creates the rings, the solution side waits for them to appear
+        print_details(f"Starting solution. Command: <{' '.join(solution_args)}>.")
+        solution_process = subprocess.Popen(solution_args, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    else:
+        with open(channel_checker_to_solution, 'r') as pipe_checker_to_solution_r:
+            with open(channel_solution_to_checker, 'w') as pipe_solution_to_checker_w:
+                print_details(f"Starting solution. Command: <{' '.join(solution_args)}>.")
+                solution_process = subprocess.Popen(solution_args, stdin=pipe_checker_to_solution_r, stdout=pipe_solution_to_checker_w, stderr=subprocess.PIPE, text=True)
      
     try:
         print_details()
@@ -36,6 +59,11 @@ def run_checker(checker_executable, solution_executable, input_file, checker_log
         out, err = checker_process.communicate(timeout=solution_timeout)
         if solution_process.returncode != 0:
             print(f"Solution exit code: {solution_process.returncode}")
+        if fused and out.strip().isdigit():
+            print_details(f"Solution was checked successfully!")
+            print_details(f"Checker score: ", end="")
+            print(out.strip())
+            return True
         if len(out.strip()) > 0:
             print_details(f"Checker returned an error: ", end="")
             print(out.strip())
@@ -47,13 +75,20 @@ def run_checker(checker_executable, solution_executable, input_file, checker_log
         solution_process.communicate()
         print_details(f"Solution and checker were running for over {solution_timeout} seconds. Terminating.")
         return False
+    finally:
+        if transport == "shm":
+            for path in (channel_checker_to_solution, channel_solution_to_checker):
+                if os.path.exists(path):
+                    os.remove(path)
 
     print_details(f"Solution was checked successfully! Checker log saved to {checker_log}.")
     return True
 
 
-def run_scorer(scorer_executable, input_file, checker_log):
+def run_scorer(scorer_executable, input_file, checker_log, report=None):
     scorer_args = scorer_executable.strip().split(' ') + [input_file, checker_log]
+    if report is not None:
+        scorer_args += ["--report", report]
 
     print_details()
     print_details(f"Starting scorer. Command: <{' '.join(scorer_args)}>. ")
@@ -62,7 +97,12 @@ def run_scorer(scorer_executable, input_file, checker_log):
     print_details(f"Scorer output: ", end="")
     print(stdout.strip())
 
-def run_generator(generator_executable, generator_seed, test_file):
+def run_generator(generator_executable, generator_seed, test_file, test_cache=None):
+    if test_cache is not None:
+        from test_cache import TestCache
+        TestCache(test_cache, generator_executable).get([generator_seed], test_file)
+        print_details(f"Test for seed={generator_seed} was taken from the cache {test_cache} to file {test_file}")
+        return
     generator_args = generator_executable.strip().split(' ') + [str(generator_seed)]
     print_details(f"Starting generator with seed={generator_seed}. Command: <{' '.join(generator_args)}>")
     generator_process = subprocess.Popen(generator_args, stdout=open(test_file, "w"), text=True)
@@ -79,6 +119,12 @@ def test_solution(
         generator="./generator",
         seed=None,
         results_only=False,
+        binary_log=False,
+        fused=False,
+        report=None,
+        transport="fifo",
+        shm_native=False,
+        test_cache=None,
         ):
     global print_details
     print_details = (lambda *a, **k: None) if results_only else print
@@ -86,12 +132,12 @@ def test_solution(
     checker_out_file = tempfile.NamedTemporaryFile(prefix="checker_log_")
 
     if seed is not None:
-        run_generator(generator, seed, test_file)
+        run_generator(generator, seed, test_file, test_cache)
     else:
         print_details("No generator seed provided. Skipping the test generaton step.")
 
-    if run_checker(checker, solution, test_file, checker_out_file.name, time_limit):
-        run_scorer(scorer, test_file, checker_out_file.name)
+    if run_checker(checker, solution, test_file, checker_out_file.name, time_limit, binary_log, fused, transport, shm_native) and not fused:
+        run_scorer(scorer, test_file, checker_out_file.name, report)
 
 def main():
     parser = argparse.ArgumentParser(description="This is an interactor that allows generating tests, checking and scoring your solutions to the \"HOT 2024 - Round 2\" problem. "
@@ -107,6 +153,12 @@ def main():
     parser.add_argument("--generator",      default = "./generator", help='Path to the generator executable (default: \'%(default)s\').')
     parser.add_argument("--seed",           type=int,                help='Seed, passed to the generator. Generator will not be executed without seed specified.')
     parser.add_argument("--results-only",   action="store_true",     help="Print only the verdict of the judge")
+    parser.add_argument("--fused",          action="store_true",     help="Let the checker compute the score online instead of writing a log and running the scorer.")
+    parser.add_argument("--report",                                  help='Make the scorer write a score attribution report: a path ending with .json or a prefix for CSV files.')
+    parser.add_argument("--transport",      default = "fifo", choices=["fifo", "shm"], help='Channel between the checker and the solution: named pipes or shared-memory rings (default: %(default)s).')
+    parser.add_argument("--shm_native",     action="store_true",     help="With --transport shm, pass the rings to the solution as '--shm <in> <out>' instead of running it through ./shm_shim.")
+    parser.add_argument("--binary_log",     action="store_true",     help="Make the checker write its log in the compact binary format (convert with ./log_convert).")
+    parser.add_argument("--test_cache",                              help="Directory of the generated test cache (see test_cache.py). Tests are generated only once per generator binary and seed.")
     args = parser.parse_args()
 
     test_solution(
@@ -118,6 +170,12 @@ def main():
         time_limit=args.time_limit,
         scorer=args.scorer,
         results_only=args.results_only,
+        binary_log=args.binary_log,
+        fused=args.fused,
+        report=args.report,
+        transport=args.transport,
+        shm_native=args.shm_native,
+        test_cache=args.test_cache,
     )
 
 if __name__ == "__main__":
@@ -0,0 +1,29 @@
+#include <iostream>
+#include <string>
+#include "algotester.h"
+#include "checker_log.h"
+using namespace std;
+
+// Converts checker logs between the text and the binary format.
+// Usage: ./log_convert <input log> <output log>
+// The output format is the opposite of the input one.
+
+int main(int argc, char* argv[])
+{
+    check(argc == 3, "Usage: ./log_convert <input log> <output log>");
+
+    string input = argv[1];
+    string output = argv[2];
+
+    if (isBinaryLog(input))
+    {
+        LogWriter writer(output, false);
+        BinLogReader(input).visit(writer);
+    }
+    else
+    {
+        AlgotesterReader in(input, false);
+        LogWriter writer(output, true);
+        visitTextLog(in, writer);
+    }
+}
@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include "score.h"
+
+using namespace std;
+
+// Upper bound of the score any policy can reach on a test, knowing all arrivals and durations in advance.
+//
+// Usage: ./offline_bound <test> [threads=<count>]
+//
+// Prints the bound to stdout, computed with the formula of the scorer, and its terms to stderr.
+//
+// A container can be allocated at step max(arrival, d) at the earliest and holds its VM from allocation to
+// allocation + duration inclusive (the VM can be shut down only after the end). A VM that hosts a container at
+// step s was created before s - d and stays alive until s, so the VMs reserved at step s cover the cpu and the
+// memory demand of every step in [s, s + d]. With demand taken at the earliest allocations, the cheapest
+// fractional mix of VM types covering the maximal demand of the window bounds the reservation of every step.
+//
+// Delaying a container by k more steps removes it from at most k windows, which saves at most k times the
+// fractional price of the container alone, while its penalty grows by 10 * (1.1^(k0 + k) - 1.1^k0). Every
+// container is charged the smallest penalty minus saving over all k, so the bound holds for delayed schedules too.
+// The used cpu time is at most the full duration of every container.
+
+const int TIME_AT_THE_END = 4774; // as in checker.cpp
+
+struct Request {
+    int arrival;
+    int start; // earliest allocation
+    int duration;
+    int cpu;
+    int mem;
+};
+
+struct DemandChange {
+    int time;
+    long long cpu;
+    long long mem;
+
+    bool operator<(const DemandChange &other) const {
+        return time < other.time;
+    }
+};
+
+// Cheapest fractional mix of VM types covering a demand: max over the vertices of the dual polygon
+// {y >= 0 : y_cpu * cpu_i + y_mem * mem_i <= price_i} of y_cpu * cpu + y_mem * mem
+class FractionalPrice {
+public:
+    FractionalPrice(const vector<int> &cpu, const vector<int> &mem, const vector<int> &price) {
+        // y_cpu as a function of y_mem is the lower envelope of the lines (price_i - y_mem * mem_i) / cpu_i
+        int m = cpu.size();
+        auto value = [&](int i, double y) { return (price[i] - y * mem[i]) / cpu[i]; };
+        double y_end = 1e18;
+        for (int i = 0; i < m; i++)
+            y_end = min(y_end, (double) price[i] / mem[i]);
+
+        int line = 0;
+        for (int i = 1; i < m; i++)
+            if (value(i, 0) < value(line, 0) || (value(i, 0) == value(line, 0) && mem[i] * (double) cpu[line] > mem[line] * (double) cpu[i]))
+                line = i;
+        double y = 0;
+        vertices.push_back({value(line, 0), 0});
+        while (true) {
+            // The first steeper line that crosses the current one
+            int next = -1;
+            double next_y = y_end;
+            for (int i = 0; i < m; i++) {
+                double slope = (double) mem[i] / cpu[i], current_slope = (double) mem[line] / cpu[line];
+                if (slope <= current_slope)
+                    continue;
+                double cross = ((double) price[i] / cpu[i] - (double) price[line] / cpu[line]) / (slope - current_slope);
+                if (cross > y && cross < next_y) {
+                    next_y = cross;
+                    next = i;
+                }
+            }
+            if (next == -1)
+                break;
+            y = next_y;
+            line = next;
+            vertices.push_back({value(line, y), y});
+        }
+        vertices.push_back({0, y_end});
+    }
+
+    // In units of the score: price per step divided by 1e4
+    double operator()(double cpu, double mem) const {
+        double res = 0;
+        for (auto &[y_cpu, y_mem] : vertices)
+            res = max(res, y_cpu * cpu + y_mem * mem);
+        return res / 1e4;
+    }
+
+private:
+    vector<pair<double, double>> vertices;
+};
+
+// Parses non-negative integers from [pos, end)
+struct Parser {
+    const char *pos, *end;
+
+    long long next() {
+        while (pos != end && (*pos < '0' || *pos > '9'))
+            pos++;
+        check(pos != end, "Unexpected end of test");
+        long long res = 0;
+        while (pos != end && *pos >= '0' && *pos <= '9')
+            res = res * 10 + (*pos++ - '0');
+        return res;
+    }
+};
+
+// Runs f(thread, first, last) on `threads` ranges of [0, n)
+template<class F>
+void parallel_for(int threads, long long n, F f) {
+    vector<thread> pool;
+    for (int i = 1; i < threads; i++)
+        pool.emplace_back(f, i, n * i / threads, n * (i + 1) / threads);
+    f(0, 0, n / threads);
+    for (auto &t : pool)
+        t.join();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: ./offline_bound <test> [threads=<count>]\n");
+        return 1;
+    }
+    int threads = max(1u, thread::hardware_concurrency());
+    for (int i = 2; i < argc; i++) {
+        if (strncmp(argv[i], "threads=", 8) == 0)
+            threads = max(1, atoi(argv[i] + 8));
+        else {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    MappedFile file(argv[1]);
+    Parser header{file.begin(), file.end()};
+    int m = header.next();
+    int d = header.next();
+    vector<int> vm_cpu(m), vm_mem(m), vm_price(m);
+    for (int i = 0; i < m; i++) {
+        vm_cpu[i] = header.next();
+        vm_mem[i] = header.next();
+        vm_price[i] = header.next();
+    }
+    long long n = header.next();
+    FractionalPrice fractional(vm_cpu, vm_mem, vm_price);
+
+    // Containers, parsed in parallel from chunks of lines
+    vector<vector<Request>> chunks(threads);
+    vector<int> chunk_max_end(threads, 0);
+    const char *body = header.pos;
+    long long body_size = file.end() - body;
+    parallel_for(threads, body_size, [&](int k, long long first, long long last) {
+        // A chunk owns the lines that start in it
+        auto line_start = [&](long long pos) {
+            while (pos > 0 && pos < body_size && body[pos - 1] != '\n')
+                pos++;
+            return body + min(pos, body_size);
+        };
+        Parser in{line_start(first), line_start(last)};
+        while (true) {
+            while (in.pos != in.end && (*in.pos < '0' || *in.pos > '9'))
+                in.pos++;
+            if (in.pos == in.end)
+                break;
+            int time = in.next();
+            in.next();
+            int cpu = in.next();
+            int mem = in.next();
+            int duration = in.next();
+            chunks[k].push_back({time, max(time, d), duration, cpu, mem});
+            chunk_max_end[k] = max(chunk_max_end[k], time + duration);
+        }
+    });
+    long long parsed = 0;
+    for (auto &chunk : chunks)
+        parsed += chunk.size();
+    check(parsed == n, "Expected " + to_string(n) + " containers, found " + to_string(parsed));
+    int t = *max_element(chunk_max_end.begin(), chunk_max_end.end()) + TIME_AT_THE_END;
+
+    // Per container: used cpu time, smallest delay penalty minus saving, and demand changes
+    const double *penalty = delayPenalty();
+    vector<double> chunk_cpu_time(threads, 0), chunk_delay(threads, 0);
+    vector<vector<DemandChange>> events(threads);
+    parallel_for(threads, threads, [&](int, long long first, long long last) {
+        for (long long k = first; k < last; k++) {
+            for (auto &c : chunks[k]) {
+                int end = min(c.start + c.duration, t);
+                chunk_cpu_time[k] += (double) c.cpu * min(c.duration, t + 1 - c.start);
+                events[k].push_back({c.start, c.cpu, c.mem});
+                events[k].push_back({end + 1, -c.cpu, -c.mem});
+
+                double alone = fractional(c.cpu, c.mem);
+                int forced = c.start - c.arrival;
+                double best = 1e18;
+                for (int extra = 0; forced + extra <= MAX_CONTAINER_ALLOCATION_TIME; extra++) {
+                    double cost = 10 * penalty[forced + extra] - extra * alone;
+                    if (cost >= best)
+                        break;
+                    best = cost;
+                }
+                chunk_delay[k] += best;
+            }
+            sort(events[k].begin(), events[k].end());
+        }
+    });
+
+    // Merge the sorted chunks pairwise
+    vector<DemandChange> all;
+    vector<size_t> bounds = {0};
+    for (auto &e : events) {
+        all.insert(all.end(), e.begin(), e.end());
+        bounds.push_back(all.size());
+        vector<DemandChange>().swap(e);
+    }
+    for (size_t width = 1; width < bounds.size() - 1; width *= 2)
+        for (size_t i = 0; i + width < bounds.size() - 1; i += 2 * width)
+            inplace_merge(all.begin() + bounds[i], all.begin() + bounds[i + width], all.begin() + bounds[min(i + 2 * width, bounds.size() - 1)]);
+
+    // Demand as segments of constant cpu and memory covering [0, t]
+    vector<int> seg_start;
+    vector<long long> seg_cpu, seg_mem;
+    long long cpu = 0, mem = 0;
+    seg_start.push_back(0);
+    seg_cpu.push_back(0);
+    seg_mem.push_back(0);
+    for (size_t i = 0; i < all.size(); ) {
+        int time = all[i].time;
+        for (; i < all.size() && all[i].time == time; i++) {
+            cpu += all[i].cpu;
+            mem += all[i].mem;
+        }
+        if (time > t)
+            break;
+        if (seg_start.back() != time) {
+            seg_start.push_back(time);
+            seg_cpu.push_back(0);
+            seg_mem.push_back(0);
+        }
+        seg_cpu.back() = cpu;
+        seg_mem.back() = mem;
+    }
+    int segments = seg_start.size();
+    seg_start.push_back(t + 1);
+
+    // Slide the window [s, s + d] over the segments. The maximum changes only when a segment enters
+    // (s = start - d) or leaves (s = end), and is kept by monotone deques of segment indices.
+    double reservation = 0;
+    deque<int> max_cpu, max_mem;
+    int enter = 0, first = 0;
+    auto push = [&](deque<int> &q, const vector<long long> &value, int k) {
+        while (!q.empty() && value[q.back()] <= value[k])
+            q.pop_back();
+        q.push_back(k);
+    };
+    for (int s = 0; s <= t; ) {
+        for (; first < segments && seg_start[first + 1] <= s; first++) {
+            if (!max_cpu.empty() && max_cpu.front() == first)
+                max_cpu.pop_front();
+            if (!max_mem.empty() && max_mem.front() == first)
+                max_mem.pop_front();
+        }
+        for (; enter < segments && seg_start[enter] <= (long long) s + d; enter++) {
+            push(max_cpu, seg_cpu, enter);
+            push(max_mem, seg_mem, enter);
+        }
+        long long next = seg_start[first + 1];
+        if (enter < segments)
+            next = min(next, (long long) seg_start[enter] - d);
+        next = min(next, (long long) t + 1);
+        reservation += (next - s) * fractional(seg_cpu[max_cpu.front()], seg_mem[max_mem.front()]);
+        s = next;
+    }
+
+    double cpu_time = 0, delay = 0;
+    for (int k = 0; k < threads; k++) {
+        cpu_time += chunk_cpu_time[k];
+        delay += chunk_delay[k];
+    }
+    double best_price = bestCpuPrice(vm_cpu, vm_price);
+    // The penalties are charged at 10x, the scorer formula takes them before the factor
+    long long bound = scoreFormula(cpu_time, best_price, reservation, delay / 10);
+    fprintf(stderr, "containers %lld, steps %d, cpu time %.0f, reservation >= %.3f, delay penalty - saving >= %.3f\n",
+            n, t, cpu_time, reservation, delay);
+    printf("%lld\n", bound);
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "session_record.h"
+using namespace std;
+
+// Plays a session recorded by `./harness --record` back to a solution and compares its output with the recorded one.
+//
+// Usage: ./replay [--full-speed] <recording> <solution> [solution args...]
+//
+// The checker side of the recording is written to the stdin of the solution, each chunk at the time it was forwarded
+// in the recorded session, or as fast as the solution reads with --full-speed. The solution keeps its stderr, so the
+// command can be wrapped in perf, valgrind and the like, or be a sanitizer build. As the input does not react to the
+// output, everything after the first divergence is only played for the sake of the profile.
+//
+// Prints the first divergence (step, line of the output, expected and actual line) or confirms identical output.
+// Exit code: 0 if the output is identical and the solution exited with 0, 1 otherwise, 2 on usage errors.
+
+extern char** environ;
+
+typedef chrono::steady_clock Clock;
+
+string line_at(const string& s, size_t pos)
+{
+    size_t l = s.rfind('\n', pos == 0 ? 0 : pos - 1);
+    l = (l == string::npos || pos == 0) ? 0 : l + 1;
+    size_t r = s.find('\n', l);
+    return s.substr(l, (r == string::npos ? s.size() : r) - l);
+}
+
+/// @brief Step of the response containing byte `pos`: every step is answered with a count followed by that many actions.
+/// @param line Set to the 1-based line of `pos`.
+int step_at(const string& output, size_t pos, int& line)
+{
+    int step = 0, left = -1;
+    line = 1;
+    for (size_t l = 0; l < output.size() && l <= pos; line++)
+    {
+        size_t r = output.find('\n', l);
+        if (r == string::npos)
+            r = output.size();
+        if (r >= pos)
+            break;
+        if (left == -1)
+            left = atoi(output.c_str() + l);
+        else
+            left--;
+        if (left == 0)
+        {
+            step++;
+            left = -1;
+        }
+        l = r + 1;
+    }
+    return step;
+}
+
+int main(int argc, char* argv[])
+{
+    signal(SIGPIPE, SIG_IGN);
+    bool full_speed = argc > 1 && strcmp(argv[1], "--full-speed") == 0;
+    int first = full_speed ? 2 : 1;
+    if (argc - first < 2)
+    {
+        fprintf(stderr, "Usage: ./replay [--full-speed] <recording> <solution> [solution args...]\n");
+        return 2;
+    }
+
+    vector<SessionChunk> chunks;
+    string error;
+    if (!readSession(argv[first], chunks, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+    string expected;
+    size_t input_bytes = 0;
+    for (auto& chunk : chunks)
+    {
+        if (chunk.direction == SESSION_FROM_SOLUTION)
+            expected += chunk.data;
+        else
+            input_bytes += chunk.data.size();
+    }
+
+    int solution_in[2], solution_out[2];
+    if (pipe(solution_in) != 0 || pipe(solution_out) != 0)
+    {
+        perror("pipe");
+        return 2;
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, solution_in[0], 0);
+    posix_spawn_file_actions_adddup2(&actions, solution_out[1], 1);
+    posix_spawn_file_actions_addclose(&actions, solution_in[1]);
+    posix_spawn_file_actions_addclose(&actions, solution_out[0]);
+
+    auto start = Clock::now();
+    pid_t pid;
+    int res = posix_spawnp(&pid, argv[first + 1], &actions, nullptr, argv + first + 1, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (res != 0)
+    {
+        fprintf(stderr, "Cannot start %s: %s\n", argv[first + 1], strerror(res));
+        return 2;
+    }
+    close(solution_in[0]);
+    close(solution_out[1]);
+
+    // Checker -> solution
+    thread feed([&]() {
+        for (auto& chunk : chunks)
+        {
+            if (chunk.direction != SESSION_TO_SOLUTION)
+                continue;
+            if (!full_speed)
+                this_thread::sleep_until(start + chrono::nanoseconds(chunk.time_ns));
+            size_t done = 0;
+            while (done < chunk.data.size())
+            {
+                ssize_t len = write(solution_in[1], chunk.data.data() + done, chunk.data.size() - done);
+                if (len <= 0)
+                    break;
+                done += len;
+            }
+            if (done < chunk.data.size())
+                break;
+        }
+        close(solution_in[1]);
+    });
+
+    // Solution -> comparison
+    string output;
+    size_t divergence = string::npos;
+    vector<char> buffer(1 << 16);
+    ssize_t len;
+    while ((len = read(solution_out[0], buffer.data(), buffer.size())) > 0)
+    {
+        if (divergence == string::npos)
+            for (ssize_t i = 0; i < len; i++)
+                if (output.size() + i >= expected.size() || buffer[i] != expected[output.size() + i])
+                {
+                    divergence = output.size() + i;
+                    break;
+                }
+        output.append(buffer.data(), len);
+    }
+    close(solution_out[0]);
+    if (divergence == string::npos && output.size() < expected.size())
+        divergence = output.size();
+
+    int status;
+    waitpid(pid, &status, 0);
+    feed.join();
+    double wall = chrono::duration<double>(Clock::now() - start).count();
+    double recorded = chunks.empty() ? 0 : chunks.back().time_ns / 1e9;
+
+    printf("chunks %zu, input %zu bytes, output %zu bytes (recorded %zu), replay %.3f s, recorded session %.3f s\n",
+        chunks.size(), input_bytes, output.size(), expected.size(), wall, recorded);
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (WIFSIGNALED(status))
+        printf("solution was killed by signal %d\n", WTERMSIG(status));
+    else if (!ok)
+        printf("solution exited with code %d\n", WEXITSTATUS(status));
+    if (divergence == string::npos)
+    {
+        printf("output is identical\n");
+        return ok ? 0 : 1;
+    }
+
+    int line;
+    int step = step_at(expected, divergence, line);
+    printf("first divergence at step %d, line %d of the output, byte %zu\n", step, line, divergence);
+    printf("  expected: %s\n", divergence < expected.size() ? line_at(expected, divergence).c_str() : "<end of output>");
+    printf("  actual:   %s\n", divergence < output.size() ? line_at(output, divergence).c_str() : "<end of output>");
+    return 1;
+}
@@ -0,0 +1,139 @@
+// Score of a checked interaction.
+//
+// Shared by the scorer (which replays the checker log) and by the checker itself when it is asked
+// to score the interaction online, so that both always report exactly the same number.
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+#include "checker_log.h"
+#include "state.h"
+
+const int MAX_CONTAINER_ALLOCATION_TIME = 4774;
+
+/// @brief Penalty `1.1^delay - 1` of a container allocated after `delay` steps, for every possible delay.
+inline const double* delayPenalty()
+{
+    static double table[MAX_CONTAINER_ALLOCATION_TIME + 1];
+    static bool ready = false;
+    if (!ready)
+    {
+        for (int k = 0; k <= MAX_CONTAINER_ALLOCATION_TIME; k++)
+            table[k] = pow(1.1, k) - 1;
+        ready = true;
+    }
+    return table;
+}
+
+/// @brief Price of the cheapest CPU in the catalog, per step.
+inline double bestCpuPrice(const vector<int>& vm_cpu, const vector<int>& vm_price)
+{
+    double best_price = 1e47;
+    for (size_t i = 0; i < vm_cpu.size(); i++)
+        best_price = min(best_price, vm_price[i] / 1e4 / vm_cpu[i]);
+    return best_price;
+}
+
+/// @brief The score formula: used CPU time at the best price over the reservation cost plus the delay penalties.
+/// @param total_cpu Sum of `cpu * steps` of the allocated containers.
+/// @param reservation_cost Sum of `price * steps` of the VMs, divided by 1e4.
+/// @param delay_cost Sum of `1.1^delay - 1` of the containers.
+inline long long scoreFormula(double total_cpu, double best_price, double reservation_cost, double delay_cost)
+{
+    return (long long)((total_cpu * best_price) / (reservation_cost + delay_cost * 10) * 1e7);
+}
+
+/// @brief Streaming score computation.
+/// @note Costs are accounted as soon as a VM or a container is shut down, so only live entities are stored.
+/// Sums are kept exact (integers and a histogram of delays), which makes the result independent of the event order.
+class ScoreAccumulator : public LogVisitor
+{
+public:
+    /// @brief Initialize with the VM catalog of the test.
+    /// @param vm_cpu CPU of every VM type.
+    /// @param vm_price Price of every VM type.
+    ScoreAccumulator(const vector<int>& vm_cpu, const vector<int>& vm_price):
+        vm_prices(vm_price), best_price(bestCpuPrice(vm_cpu, vm_price)), delays(MAX_CONTAINER_ALLOCATION_TIME + 1, 0) {}
+
+    void begin(int t)
+    {
+        this->t = t;
+    }
+
+    void containerNew(int j, int cont_id, int cpu, int mem)
+    {
+        cluster.containerNew(j, cont_id, cpu, mem);
+    }
+
+    void assign(int j, int cont_id, int vm_id)
+    {
+        // The fused checker reports actions before validating them
+        if (!cluster.containers.contains(cont_id) || !cluster.vms.contains(vm_id))
+            return;
+        auto& container = cluster.assign(j, cont_id, vm_id);
+        delays[min(j - container.arrival, MAX_CONTAINER_ALLOCATION_TIME)]++;
+    }
+
+    void containerEnd(int j, int cont_id)
+    {
+        if (!cluster.containers.contains(cont_id))
+            return;
+        auto& container = cluster.containers[cont_id];
+        cpu_time += (long long)(j - container.allocation_time) * container.cpu;
+        cluster.containerEnd(j, cont_id);
+    }
+
+    void vmCreate(int j, int vm_id, int vm_type)
+    {
+        cluster.vmCreate(j, vm_id, vm_type - 1);
+    }
+
+    void vmShutdown(int j, int vm_id)
+    {
+        if (!cluster.vms.contains(vm_id))
+            return;
+        auto& vm = cluster.vms[vm_id];
+        reservation += (long long)(j - vm.start_time) * vm_prices[vm.type];
+        cluster.vms.erase(vm_id);
+    }
+
+    /// @brief Final score. Containers and VMs still alive are accounted until step t + 1.
+    long long score() const
+    {
+        long long total_reservation = reservation;
+        cluster.vms.forEach([&](int id, const VM& vm) {
+            total_reservation += (long long)(t + 1 - vm.start_time) * vm_prices[vm.type];
+        });
+
+        long long total_cpu_time = cpu_time;
+        vector<long long> total_delays = delays;
+        cluster.containers.forEach([&](int id, const Container& container) {
+            // Never allocated containers are charged the maximal delay
+            if (container.allocation_time == -1)
+                total_delays[MAX_CONTAINER_ALLOCATION_TIME]++;
+            else
+                total_cpu_time += (long long)(t + 1 - container.allocation_time) * container.cpu;
+        });
+
+        const double* penalty = delayPenalty();
+        double delay_cost = 0;
+        for (int k = 0; k <= MAX_CONTAINER_ALLOCATION_TIME; k++)
+            delay_cost += total_delays[k] * penalty[k];
+
+        return scoreFormula(total_cpu_time, best_price, total_reservation / 1e4, delay_cost);
+    }
+
+private:
+    vector<int> vm_prices;
+    double best_price;
+    int t = 0;
+
+    long long reservation = 0;
+    long long cpu_time = 0;
+    vector<long long> delays;
+
+    // Only live VMs and containers, VM types are not needed for trusted accounting
+    Cluster<HashedStorage> cluster;
+};
@@ -0,0 +1,342 @@
+// Score attribution report.
+//
+// Collected in the same pass as the score itself and written either as one JSON document or as a set of CSV files:
+//  * reservation cost and average utilization per VM type;
+//  * histogram of container allocation delays and the delay cost they cause;
+//  * the containers that waited the longest;
+//  * time series of fleet utilization, live VMs and pending containers.
+// The VMs and containers are followed by a cluster of state.h, whose instrumentation counts the live VMs.
+
+#pragma once
+#include <algorithm>
+#include <cstdio>
+#include <queue>
+#include <string>
+#include <vector>
+#include "checker_log.h"
+#include "score.h"
+#include "state.h"
+
+class ScoreReport : public LogVisitor
+{
+public:
+    /// @param vm_cpu CPU of every VM type.
+    /// @param vm_mem Memory of every VM type.
+    /// @param vm_price Price of every VM type.
+    /// @param bucket Number of steps in one point of the time series, 0 to pick it from t.
+    ScoreReport(const vector<int>& vm_cpu, const vector<int>& vm_mem, const vector<int>& vm_price, int bucket = 0):
+        types(vm_cpu.size()), delays(MAX_CONTAINER_ALLOCATION_TIME + 1, 0), bucket(bucket)
+    {
+        for (size_t i = 0; i < vm_cpu.size(); i++)
+            cluster.types.push_back(VMType(vm_cpu[i], vm_mem[i], vm_price[i]));
+    }
+
+    void begin(int t)
+    {
+        this->t = t;
+        if (bucket <= 0)
+            bucket = max(1, (t + TIMELINE_POINTS - 1) / TIMELINE_POINTS);
+    }
+
+    void containerNew(int j, int cont_id, int cpu, int mem)
+    {
+        advance(j);
+        cluster.containerNew(j, cont_id, cpu, mem);
+    }
+
+    void assign(int j, int cont_id, int vm_id)
+    {
+        advance(j);
+        // The fused checker reports actions before validating them
+        if (!cluster.containers.contains(cont_id) || !cluster.vms.contains(vm_id))
+            return;
+        auto& container = cluster.assign(j, cont_id, vm_id);
+        used_cpu += container.cpu;
+        used_mem += container.mem;
+
+        int delay = min(j - container.arrival, MAX_CONTAINER_ALLOCATION_TIME);
+        delays[delay]++;
+        worst.push({delay, cont_id});
+        if ((int)worst.size() > WORST_CONTAINERS)
+            worst.pop();
+    }
+
+    void containerEnd(int j, int cont_id)
+    {
+        advance(j);
+        if (!cluster.containers.contains(cont_id))
+            return;
+        auto& container = cluster.containers[cont_id];
+        if (container.allocation_time != -1)
+            finishContainer(container, j);
+        cluster.containerEnd(j, cont_id);
+    }
+
+    void vmCreate(int j, int vm_id, int vm_type)
+    {
+        advance(j);
+        if (cluster.vms.contains(vm_id))
+            return;
+        cluster.vmCreate(j, vm_id, vm_type - 1);
+        types[vm_type - 1].vms++;
+        reserved_cpu += cluster.types[vm_type - 1].cpu;
+        reserved_mem += cluster.types[vm_type - 1].mem;
+    }
+
+    void vmShutdown(int j, int vm_id)
+    {
+        advance(j);
+        if (!cluster.vms.contains(vm_id) || cluster.vms[vm_id].shutdown_time != -1)
+            return;
+        finishVM(cluster.vms[vm_id], j);
+        cluster.vmShutdown(j, vm_id);
+        // Only the live VMs are needed: the containers of a VM have ended before it is shut down
+        cluster.vms.erase(vm_id);
+    }
+
+    void end()
+    {
+        advance(t);
+        flushBucket();
+        cluster.containers.forEach([&](int id, const Container& container) {
+            if (container.allocation_time != -1)
+                finishContainer(container, t + 1);
+        });
+        cluster.vms.forEach([&](int id, const VM& vm) {
+            finishVM(vm, t + 1);
+        });
+        // Everything is accounted, only the catalog is kept for the output
+        vector<VMType> catalog = cluster.types;
+        cluster = ReportCluster();
+        cluster.types = catalog;
+    }
+
+    /// @brief Write the report as JSON.
+    void writeJson(const string& filename, long long score)
+    {
+        FILE* f = fopen(filename.c_str(), "w");
+        check(f != nullptr, "Cannot open report " + filename);
+
+        double reservation_cost = 0;
+        for (auto& type : types)
+            reservation_cost += type.reserved_price / 1e4;
+        fprintf(f, "{\n  \"score\": %lld,\n  \"reservation_cost\": %.4f,\n  \"delay_cost\": %.4f,\n", score, reservation_cost, delayCost(0, MAX_CONTAINER_ALLOCATION_TIME + 1));
+
+        fprintf(f, "  \"vm_types\": [\n");
+        for (size_t i = 0; i < types.size(); i++)
+        {
+            auto& type = types[i];
+            auto& vm_type = cluster.types[i];
+            fprintf(f, "    {\"type\": %d, \"cpu\": %d, \"mem\": %d, \"price\": %d, \"vms\": %lld, \"reserved_steps\": %lld, \"reservation_cost\": %.4f, \"cpu_util\": %.6f, \"mem_util\": %.6f}%s\n",
+                (int)i + 1, vm_type.cpu, vm_type.mem, vm_type.price, type.vms, type.reserved_steps, type.reserved_price / 1e4,
+                util(type.used_cpu_time, type.reserved_steps * vm_type.cpu), util(type.used_mem_time, type.reserved_steps * vm_type.mem),
+                i + 1 < types.size() ? "," : "");
+        }
+        fprintf(f, "  ],\n");
+
+        auto buckets = delayBuckets();
+        fprintf(f, "  \"delays\": [\n");
+        for (size_t i = 0; i < buckets.size(); i++)
+        {
+            auto [l, r] = buckets[i];
+            fprintf(f, "    {\"from\": %d, \"to\": %d, \"containers\": %lld, \"delay_cost\": %.4f}%s\n",
+                l, r - 1, delayCount(l, r), delayCost(l, r), i + 1 < buckets.size() ? "," : "");
+        }
+        fprintf(f, "  ],\n");
+
+        auto worst_list = worstContainers();
+        fprintf(f, "  \"worst_containers\": [\n");
+        for (size_t i = 0; i < worst_list.size(); i++)
+            fprintf(f, "    {\"id\": %d, \"delay\": %d}%s\n", worst_list[i].second, worst_list[i].first, i + 1 < worst_list.size() ? "," : "");
+        fprintf(f, "  ],\n");
+
+        fprintf(f, "  \"timeline\": [\n");
+        for (size_t i = 0; i < timeline.size(); i++)
+        {
+            auto& p = timeline[i];
+            fprintf(f, "    {\"from\": %d, \"to\": %d, \"cpu_util\": %.6f, \"mem_util\": %.6f, \"live_vms\": %.3f, \"pending_containers\": %.3f}%s\n",
+                p.from, p.to, p.cpu_util, p.mem_util, p.live_vms, p.pending, i + 1 < timeline.size() ? "," : "");
+        }
+        fprintf(f, "  ]\n}\n");
+        fclose(f);
+    }
+
+    /// @brief Write the report as CSV files `<prefix>_vm_types.csv`, `<prefix>_delays.csv`, `<prefix>_worst.csv` and `<prefix>_timeline.csv`.
+    void writeCsv(const string& prefix)
+    {
+        FILE* f = openCsv(prefix + "_vm_types.csv", "type,cpu,mem,price,vms,reserved_steps,reservation_cost,cpu_util,mem_util");
+        for (size_t i = 0; i < types.size(); i++)
+        {
+            auto& type = types[i];
+            auto& vm_type = cluster.types[i];
+            fprintf(f, "%d,%d,%d,%d,%lld,%lld,%.4f,%.6f,%.6f\n", (int)i + 1, vm_type.cpu, vm_type.mem, vm_type.price, type.vms, type.reserved_steps, type.reserved_price / 1e4,
+                util(type.used_cpu_time, type.reserved_steps * vm_type.cpu), util(type.used_mem_time, type.reserved_steps * vm_type.mem));
+        }
+        fclose(f);
+
+        f = openCsv(prefix + "_delays.csv", "from,to,containers,delay_cost");
+        for (auto [l, r] : delayBuckets())
+            fprintf(f, "%d,%d,%lld,%.4f\n", l, r - 1, delayCount(l, r), delayCost(l, r));
+        fclose(f);
+
+        f = openCsv(prefix + "_worst.csv", "id,delay");
+        for (auto [delay, id] : worstContainers())
+            fprintf(f, "%d,%d\n", id, delay);
+        fclose(f);
+
+        f = openCsv(prefix + "_timeline.csv", "from,to,cpu_util,mem_util,live_vms,pending_containers");
+        for (auto& p : timeline)
+            fprintf(f, "%d,%d,%.6f,%.6f,%.3f,%.3f\n", p.from, p.to, p.cpu_util, p.mem_util, p.live_vms, p.pending);
+        fclose(f);
+    }
+
+private:
+    static const int TIMELINE_POINTS = 200;
+    static const int WORST_CONTAINERS = 10;
+
+    struct TypeStats
+    {
+        long long vms = 0;
+        long long reserved_steps = 0;
+        long long reserved_price = 0;
+        long long used_cpu_time = 0;
+        long long used_mem_time = 0;
+    };
+
+    typedef Cluster<HashedStorage, TrustedValidation, CountingInstrumentation> ReportCluster;
+
+    struct TimelinePoint
+    {
+        int from, to;
+        double cpu_util, mem_util;
+        double live_vms, pending;
+    };
+
+    ReportCluster cluster;
+    vector<TypeStats> types;
+    vector<long long> delays;
+    // Min-heap of (delay, container id), so the top is the first to be evicted
+    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> worst;
+
+    int t = 0;
+    int bucket;
+
+    // Current fleet state
+    long long reserved_cpu = 0, reserved_mem = 0;
+    long long used_cpu = 0, used_mem = 0;
+
+    // Integrals of the fleet state over the current bucket
+    int now = 0;
+    int bucket_start = 0;
+    double sum_reserved_cpu = 0, sum_reserved_mem = 0;
+    double sum_used_cpu = 0, sum_used_mem = 0;
+    double sum_live_vms = 0, sum_pending = 0;
+    vector<TimelinePoint> timeline;
+
+    void finishContainer(const Container& container, int j)
+    {
+        used_cpu -= container.cpu;
+        used_mem -= container.mem;
+        auto& type = types[cluster.vms[container.vm].type];
+        type.used_cpu_time += (long long)(j - container.allocation_time) * container.cpu;
+        type.used_mem_time += (long long)(j - container.allocation_time) * container.mem;
+    }
+
+    void finishVM(const VM& vm, int j)
+    {
+        reserved_cpu -= cluster.types[vm.type].cpu;
+        reserved_mem -= cluster.types[vm.type].mem;
+        auto& type = types[vm.type];
+        type.reserved_steps += j - vm.start_time;
+        type.reserved_price += (long long)(j - vm.start_time) * cluster.types[vm.type].price;
+    }
+
+    /// @brief Integrate the fleet state up to step j, closing the buckets passed on the way.
+    void advance(int j)
+    {
+        while (now < j)
+        {
+            int next = min(j, bucket_start + bucket);
+            double dt = next - now;
+            sum_reserved_cpu += reserved_cpu * dt;
+            sum_reserved_mem += reserved_mem * dt;
+            sum_used_cpu += used_cpu * dt;
+            sum_used_mem += used_mem * dt;
+            sum_live_vms += liveVMs() * dt;
+            sum_pending += cluster.unallocated * dt;
+            now = next;
+            if (now == bucket_start + bucket)
+                flushBucket();
+        }
+    }
+
+    void flushBucket()
+    {
+        if (now == bucket_start)
+            return;
+        double len = now - bucket_start;
+        timeline.push_back({bucket_start, now - 1, util(sum_used_cpu, sum_reserved_cpu), util(sum_used_mem, sum_reserved_mem), sum_live_vms / len, sum_pending / len});
+        bucket_start = now;
+        sum_reserved_cpu = sum_reserved_mem = sum_used_cpu = sum_used_mem = sum_live_vms = sum_pending = 0;
+    }
+
+    long long liveVMs() const
+    {
+        auto& counts = cluster.instrumentation.counts;
+        return counts[OP_VM_CREATE] - counts[OP_VM_SHUTDOWN];
+    }
+
+    static double util(double used, double reserved)
+    {
+        return reserved > 0 ? used / reserved : 0;
+    }
+
+    /// @brief Delay ranges [l, r) of the histogram: 0, 1, 2-3, 4-7, ... and the maximal delay on its own.
+    vector<pair<int, int>> delayBuckets() const
+    {
+        vector<pair<int, int>> res = {{0, 1}};
+        for (int l = 1; l < MAX_CONTAINER_ALLOCATION_TIME; l *= 2)
+            res.push_back({l, min(2 * l, MAX_CONTAINER_ALLOCATION_TIME)});
+        res.push_back({MAX_CONTAINER_ALLOCATION_TIME, MAX_CONTAINER_ALLOCATION_TIME + 1});
+        return res;
+    }
+
+    long long delayCount(int l, int r) const
+    {
+        long long res = 0;
+        for (int k = l; k < r; k++)
+            res += delays[k];
+        return res;
+    }
+
+    /// @brief Delay cost of containers with delay in [l, r), weighted as in the score.
+    double delayCost(int l, int r) const
+    {
+        const double* penalty = delayPenalty();
+        double res = 0;
+        for (int k = l; k < r; k++)
+            res += delays[k] * penalty[k];
+        return res * 10;
+    }
+
+    vector<pair<int, int>> worstContainers() const
+    {
+        auto heap = worst;
+        vector<pair<int, int>> res;
+        while (!heap.empty())
+        {
+            res.push_back(heap.top());
+            heap.pop();
+        }
+        reverse(res.begin(), res.end());
+        return res;
+    }
+
+    static FILE* openCsv(const string& filename, const char* header)
+    {
+        FILE* f = fopen(filename.c_str(), "w");
+        check(f != nullptr, "Cannot open report " + filename);
+        fprintf(f, "%s\n", header);
+        return f;
+    }
+};
@@ -2,6 +2,12 @@
 
 #include "algotester.h"
 
+#include "checker_log.h"
+
+#include "score.h"
+
+#include "score_report.h"
+
 // #include "algotester_generator.h"
 
 using namespace std;
@@ -44,93 +50,63 @@ const LL LINF = INF * (LL) INF;
 
 
 
-const int MAX_CONTAINER_ALLOCATION_TIME = 4774;
-
+VI vm_cpus;
 
+VI vm_mems;
 
 VI vm_prices;
 
 
 
-struct VM
+void read_test(AlgotesterReader& in)
 
 {
 
-    int start_time;
-
-    int end_time;
-
-    int type;
-
-
-
-    VM()
-
-    {
-
-        start_time = -1;
-
-        end_time = -1;
-
-        type = -1;
-
-    }
-
-};
+    int m = in.readInt();
 
+    in.readInt();
 
+    vm_cpus.resize(m);
 
-struct Container
+    vm_mems.resize(m);
 
-{
+    vm_prices.resize(m);
 
-    int start_time;
 
-    int allocation_time;
 
+    FOR (i, 0, m)
 
+    {
 
-    int shutdown_time = -1;
+        vm_cpus[i] = in.readInt();
 
-    int cpu;
+        vm_mems[i] = in.readInt();
 
-};
+        vm_prices[i] = in.readInt();
 
+    }
 
+}
 
-double best_price = 1e47;
 
 
+template<class Visitor>
 
-void read_test(AlgotesterReader& in)
+void visit_log(string filename, Visitor& visitor)
 
 {
 
-    int m = in.readInt();
-
-    in.readInt();
-
-    vm_prices.resize(m);
-
+    if (isBinaryLog(filename))
 
+        BinLogReader(filename).visit(visitor);
 
-    FOR (i, 0, m)
+    else
 
     {
 
-        int cpu = in.readInt();
-
-        in.readInt();
-
-        int price = in.readInt();
-
-
-
-        vm_prices[i] = price;
-
+        MappedTextReader log(filename);
 
-
-        best_price = min(best_price, price / 1e4 / cpu);
+        visitTextLog(log, visitor);
 
     }
 
@@ -146,190 +122,69 @@ int main(int argc, char* argv[])
 
 
 
-    auto [test_in, checker_out, ans] = initScorer(argc, argv);
-
-
-
-    read_test(test_in);
-
-
-
-    map<int, Container> containers;
-
-    map<int, VM> vms;
-
+    // Usage: ./scorer <test> <checker log> [--report <file.json | csv prefix>] [--bucket <steps>]
 
+    auto [test_in, checker_out, ans] = initScorer(argc, argv);
 
-    VI delays;
 
 
+    string report_path;
 
-    int t = checker_out.readInt();
+    int bucket = 0;
 
-    FOR (j, 0, t)
+    FOR (i, 3, argc - 1)
 
     {
 
-        int e = checker_out.readInt();
-
-        int cnt = 1;
-
-        if (e == 0) cnt = checker_out.readInt();
-
-
-
-        FOR (k, 0, e)
-
-        {
-
-            int type = checker_out.readInt();
-
-            if (type == 1)
-
-            {
-
-                int cont_id = checker_out.readInt();
-
-                int cpu = checker_out.readInt();
-
-                checker_out.readInt();
+        if (string(argv[i]) == "--report") report_path = argv[i + 1];
 
-
-
-                containers[cont_id].start_time = j;
-
-                containers[cont_id].cpu = cpu;
-
-
-
-            }
-
-            if (type == 2)
-
-            {
-
-                int cont_id = checker_out.readInt();
-
-                containers[cont_id].shutdown_time = j;
-
-            }
-
-        }
-
-
-
-        j--;
-
-        FOR (it, 0, cnt)
-
-        {
-
-            j++;
-
-            int a = checker_out.readInt();
-
-            FOR (k, 0, a)
-
-            {
-
-                int type = checker_out.readInt();
-
-                if (type == 1)
-
-                {
-
-                    int vm_id = checker_out.readInt();
-
-                    int vm_type = checker_out.readInt();
-
-
-
-                    vms[vm_id].start_time = j;
-
-                    vms[vm_id].type = vm_type - 1;
-
-                }
-
-                if (type == 2)
-
-                {
-
-                    int vm_id = checker_out.readInt();
-
-
-
-                    vms[vm_id].end_time = j;
-
-                }
-
-                if (type == 3)
-
-                {
-
-                    int cont_id = checker_out.readInt();
-
-                    checker_out.readInt();
-
-
-
-                    containers[cont_id].allocation_time = j;
-
-                }
-
-            }
-
-        }
+        if (string(argv[i]) == "--bucket") bucket = atoi(argv[i + 1]);
 
     }
 
 
 
-    double reservation_cost = 0;
-
-
-
-    ITER(it, vms)
-
-    {
-
-        if (it->second.end_time == -1) it->second.end_time = t + 1;
-
-        reservation_cost += (it->second.end_time - it->second.start_time) * (double)vm_prices[it->second.type] / 1e4;
-
-    }
+    read_test(test_in);
 
 
 
-    double delay_cost = 0;
+    ScoreAccumulator score(vm_cpus, vm_prices);
 
-    double total_cpu = 0;
+    if (report_path.empty())
 
+    {
 
+        visit_log(argv[2], score);
 
-    ITER(it, containers)
+        cout<<score.score()<<endl;
 
-    {
+        return 0;
 
-        delay_cost += pow(1.1, min(it->second.allocation_time - it->second.start_time, MAX_CONTAINER_ALLOCATION_TIME)) - 1;
+    }
 
-        if (it->second.shutdown_time == -1) it->second.shutdown_time = t + 1;
 
 
+    ScoreReport report(vm_cpus, vm_mems, vm_prices, bucket);
 
-        total_cpu += (it->second.shutdown_time - it->second.allocation_time) * (double)it->second.cpu;
+    LogTee<ScoreAccumulator, ScoreReport> both(&score, &report);
 
-    }
+    visit_log(argv[2], both);
 
 
 
-    LL score = (LL)((total_cpu * best_price) / (reservation_cost + delay_cost * 10) * 1e7);
+    LL result = score.score();
 
+    if (report_path.size() >= 5 && report_path.substr(report_path.size() - 5) == ".json")
 
+        report.writeJson(report_path, result);
 
-    cout<<score<<endl;
+    else
 
+        report.writeCsv(report_path);
 
 
 
+    cout<<result<<endl;
 
 }
+
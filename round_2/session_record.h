@@ -0,0 +1,91 @@
+// Recording of an interactive session: the exact bytes exchanged by the checker and the solution, in the order
+// and at the times the harness forwarded them.
+//
+// File layout: the magic "HSESSION", then one record per forwarded chunk:
+//   uint8 direction (SESSION_TO_SOLUTION or SESSION_FROM_SOLUTION), uint64 nanoseconds since the start,
+//   uint32 length, `length` bytes.
+// Chunks are cut wherever a read of the harness returned, so only the concatenation of one direction is meaningful,
+// together with the order of the chunks of both directions.
+
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+const char SESSION_MAGIC[8] = {'H', 'S', 'E', 'S', 'S', 'I', 'O', 'N'};
+
+enum SessionDirection : uint8_t { SESSION_TO_SOLUTION = 0, SESSION_FROM_SOLUTION = 1 };
+
+struct SessionChunk
+{
+    SessionDirection direction;
+    uint64_t time_ns;
+    std::string data;
+};
+
+class SessionWriter
+{
+public:
+    /// @brief Open the recording, nullptr on failure (errno is set).
+    static SessionWriter* open(const std::string& path)
+    {
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f)
+            return nullptr;
+        setvbuf(f, nullptr, _IOFBF, 1 << 20);
+        fwrite(SESSION_MAGIC, 1, sizeof(SESSION_MAGIC), f);
+        return new SessionWriter(f);
+    }
+
+    ~SessionWriter() { fclose(f); }
+
+    void write(SessionDirection direction, uint64_t time_ns, const char* data, uint32_t len)
+    {
+        uint8_t dir = direction;
+        fwrite(&dir, sizeof(dir), 1, f);
+        fwrite(&time_ns, sizeof(time_ns), 1, f);
+        fwrite(&len, sizeof(len), 1, f);
+        fwrite(data, 1, len, f);
+    }
+
+private:
+    explicit SessionWriter(FILE* f): f(f) {}
+
+    FILE* f;
+};
+
+/// @brief Read a whole recording.
+/// @return False with `error` set if the file can not be opened or is not a complete recording.
+inline bool readSession(const std::string& path, std::vector<SessionChunk>& chunks, std::string& error)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        error = "Cannot open " + path;
+        return false;
+    }
+    char magic[sizeof(SESSION_MAGIC)];
+    bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && std::string(magic, sizeof(magic)) == std::string(SESSION_MAGIC, sizeof(SESSION_MAGIC));
+    if (!ok)
+        error = path + " is not a session recording";
+    uint8_t dir;
+    while (ok && fread(&dir, sizeof(dir), 1, f) == 1)
+    {
+        SessionChunk chunk;
+        uint32_t len;
+        chunk.direction = (SessionDirection)dir;
+        ok = dir <= SESSION_FROM_SOLUTION && fread(&chunk.time_ns, sizeof(chunk.time_ns), 1, f) == 1 && fread(&len, sizeof(len), 1, f) == 1;
+        if (ok)
+        {
+            chunk.data.resize(len);
+            ok = fread(&chunk.data[0], 1, len, f) == len;
+        }
+        if (ok)
+            chunks.push_back(std::move(chunk));
+        else
+            error = path + " is truncated or corrupt after " + std::to_string(chunks.size()) + " chunks";
+    }
+    fclose(f);
+    return ok;
+}
@@ -0,0 +1,402 @@
+// Shared-memory transport for the interactive protocol.
+//
+// Each direction is a single-producer single-consumer byte ring in a file mapped by both processes
+// (normally under /dev/shm). The text protocol is unchanged: the rings are exposed as `streambuf`s,
+// so the checker and the solution keep using their usual streams. A side that runs out of data or space
+// spins briefly and then sleeps on a futex; the other side only issues the wake-up syscall if a sleeper
+// has announced itself.
+
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "algotester.h"
+
+const uint32_t SHM_RING_MAGIC = 0x474e5248; // "HRNG"
+const uint32_t SHM_RING_CAPACITY = 1 << 20;
+
+struct ShmRingHeader
+{
+    atomic<uint32_t> magic;
+    uint32_t capacity;
+    atomic<int32_t> writer_pid;
+    atomic<int32_t> reader_pid;
+
+    // Producer side
+    alignas(64) atomic<uint64_t> head;
+    atomic<uint32_t> data_seq;
+    atomic<uint32_t> reader_waiting;
+
+    // Consumer side
+    alignas(64) atomic<uint64_t> tail;
+    atomic<uint32_t> space_seq;
+    atomic<uint32_t> writer_waiting;
+
+    alignas(64) atomic<uint32_t> closed;
+};
+
+static_assert(atomic<uint32_t>::is_always_lock_free && atomic<uint64_t>::is_always_lock_free, "Shared-memory ring needs lock-free atomics");
+
+class ShmRing
+{
+public:
+    /// @brief Create a ring at the given path, replacing any stale one.
+    static ShmRing* create(const string& path, uint32_t capacity = SHM_RING_CAPACITY)
+    {
+        unlink(path.c_str());
+        int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        check(fd != -1, "Cannot create shared-memory ring " + path);
+        size_t size = sizeof(ShmRingHeader) + capacity;
+        check(ftruncate(fd, size) == 0, "Cannot resize shared-memory ring " + path);
+        ShmRing* ring = new ShmRing(fd, size);
+
+        ShmRingHeader* h = ring->header;
+        h->capacity = capacity;
+        h->writer_pid = 0;
+        h->reader_pid = 0;
+        h->head = 0;
+        h->data_seq = 0;
+        h->reader_waiting = 0;
+        h->tail = 0;
+        h->space_seq = 0;
+        h->writer_waiting = 0;
+        h->closed = 0;
+        h->magic.store(SHM_RING_MAGIC, memory_order_release);
+        return ring;
+    }
+
+    /// @brief Attach to a ring created by the other process, waiting for it to appear.
+    static ShmRing* attach(const string& path, int timeout_ms = 10000)
+    {
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout_ms);
+        while (true)
+        {
+            int fd = open(path.c_str(), O_RDWR);
+            struct stat st;
+            if (fd != -1 && fstat(fd, &st) == 0 && (size_t)st.st_size > sizeof(ShmRingHeader))
+            {
+                ShmRing* ring = new ShmRing(fd, st.st_size);
+                if (ring->header->magic.load(memory_order_acquire) == SHM_RING_MAGIC)
+                    return ring;
+                delete ring;
+            }
+            else if (fd != -1)
+                ::close(fd);
+            check(chrono::steady_clock::now() < deadline, "Shared-memory ring " + path + " did not appear");
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    ~ShmRing()
+    {
+        munmap(header, size);
+    }
+
+    /// @brief Register the calling process as the producer.
+    void setWriter() { header->writer_pid = getpid(); }
+
+    /// @brief Register the calling process as the consumer.
+    void setReader() { header->reader_pid = getpid(); }
+
+    /// @brief Copy all bytes into the ring, waiting for space when it is full.
+    /// @return False if the consumer is gone.
+    bool write(const char* data, size_t len)
+    {
+        uint32_t capacity = header->capacity;
+        uint64_t head = header->head.load(memory_order_relaxed);
+        while (len > 0)
+        {
+            uint64_t tail = header->tail.load(memory_order_acquire);
+            if (head - tail == capacity)
+            {
+                if (!waitFor(header->space_seq, header->writer_waiting, header->reader_pid, [&]() { return header->tail.load() != tail; }))
+                    return false;
+                continue;
+            }
+            size_t pos = head % capacity;
+            size_t chunk = min({len, (size_t)(capacity - (head - tail)), (size_t)(capacity - pos)});
+            memcpy(buffer() + pos, data, chunk);
+            data += chunk;
+            len -= chunk;
+            head += chunk;
+            header->head.store(head, memory_order_release);
+            notify(header->data_seq, header->reader_waiting);
+        }
+        return true;
+    }
+
+    /// @brief Wait until data is available and return the contiguous readable span.
+    /// @return Length of the span, 0 on end of stream.
+    size_t peek(const char*& data)
+    {
+        while (true)
+        {
+            uint64_t tail = header->tail.load(memory_order_relaxed);
+            uint64_t head = header->head.load(memory_order_acquire);
+            if (head != tail)
+            {
+                size_t pos = tail % header->capacity;
+                data = buffer() + pos;
+                return min((size_t)(head - tail), (size_t)(header->capacity - pos));
+            }
+            if (header->closed.load())
+            {
+                // Data published right before closing must still be delivered
+                if (header->head.load() != tail)
+                    continue;
+                return 0;
+            }
+            if (!waitFor(header->data_seq, header->reader_waiting, header->writer_pid, [&]() { return header->head.load() != tail || header->closed.load(); }))
+                return 0;
+        }
+    }
+
+    /// @brief Release bytes returned by `peek`.
+    void consume(size_t len)
+    {
+        header->tail.store(header->tail.load(memory_order_relaxed) + len, memory_order_release);
+        notify(header->space_seq, header->writer_waiting);
+    }
+
+    /// @brief Mark the end of the stream.
+    void close()
+    {
+        header->closed.store(1);
+        header->data_seq.fetch_add(1);
+        futexWake(header->data_seq);
+        header->space_seq.fetch_add(1);
+        futexWake(header->space_seq);
+    }
+
+private:
+    static const int SPIN_ITERATIONS = 4000;
+    static const int SLEEP_TIMEOUT_MS = 50;
+
+    ShmRingHeader* header;
+    size_t size;
+
+    ShmRing(int fd, size_t size): size(size)
+    {
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        check(data != MAP_FAILED, "Cannot map shared-memory ring");
+        header = (ShmRingHeader*)data;
+    }
+
+    char* buffer() { return (char*)(header + 1); }
+
+    static void futexWait(atomic<uint32_t>& word, uint32_t value, int timeout_ms)
+    {
+        struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+        syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAIT, value, &timeout, nullptr, 0);
+    }
+
+    static void futexWake(atomic<uint32_t>& word)
+    {
+        syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+    }
+
+    static void notify(atomic<uint32_t>& seq, atomic<uint32_t>& waiting)
+    {
+        seq.fetch_add(1);
+        if (waiting.load())
+            futexWake(seq);
+    }
+
+    /// @brief Spin, then sleep on `seq` until `ready` holds.
+    /// @return False if the stream was closed or the peer process has died.
+    template<class Ready>
+    bool waitFor(atomic<uint32_t>& seq, atomic<uint32_t>& waiting, atomic<int32_t>& peer_pid, Ready ready)
+    {
+        // Spinning only makes sense if the peer can run at the same time
+        static const int spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPIN_ITERATIONS : 0;
+        for (int i = 0; i < spin; i++)
+        {
+            if (ready())
+                return true;
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+        while (true)
+        {
+            uint32_t value = seq.load();
+            waiting.store(1);
+            if (ready())
+            {
+                waiting.store(0);
+                return true;
+            }
+            if (header->closed.load())
+            {
+                waiting.store(0);
+                return false;
+            }
+            futexWait(seq, value, SLEEP_TIMEOUT_MS);
+            waiting.store(0);
+            int32_t pid = peer_pid.load();
+            if (pid != 0 && kill(pid, 0) != 0 && errno == ESRCH)
+                return ready();
+        }
+    }
+};
+
+/// @brief Output stream buffer that publishes into a ring on flush.
+class ShmRingOutBuf : public streambuf
+{
+public:
+    ShmRingOutBuf(ShmRing* ring): ring(ring), buffer(BUFFER_SIZE)
+    {
+        ring->setWriter();
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+
+    ~ShmRingOutBuf()
+    {
+        close();
+    }
+
+    /// @brief Flush pending output and mark the end of the stream.
+    void close()
+    {
+        if (!ring)
+            return;
+        sync();
+        ring->close();
+        ring = nullptr;
+    }
+
+protected:
+    int overflow(int c) override
+    {
+        if (sync() != 0)
+            return traits_type::eof();
+        if (c != traits_type::eof())
+        {
+            *pptr() = (char)c;
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override
+    {
+        if (!ring)
+            return -1;
+        bool ok = ring->write(pbase(), pptr() - pbase());
+        setp(buffer.data(), buffer.data() + buffer.size());
+        return ok ? 0 : -1;
+    }
+
+private:
+    static const size_t BUFFER_SIZE = 1 << 16;
+
+    ShmRing* ring;
+    vector<char> buffer;
+};
+
+/// @brief Input stream buffer that reads directly from the ring memory.
+class ShmRingInBuf : public streambuf
+{
+public:
+    ShmRingInBuf(ShmRing* ring): ring(ring)
+    {
+        ring->setReader();
+        setg(nullptr, nullptr, nullptr);
+    }
+
+protected:
+    int underflow() override
+    {
+        // The previous span is released only now, so the get area can point straight into the ring
+        if (eback() != nullptr)
+            ring->consume(egptr() - eback());
+        const char* data;
+        size_t len = ring->peek(data);
+        if (len == 0)
+        {
+            setg(nullptr, nullptr, nullptr);
+            return traits_type::eof();
+        }
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + len);
+        return traits_type::to_int_type(*begin);
+    }
+
+private:
+    ShmRing* ring;
+};
+
+inline ShmRingOutBuf*& shmCheckerOutput()
+{
+    static ShmRingOutBuf* buf = nullptr;
+    return buf;
+}
+
+/// @brief Initialize interactive checker over shared-memory rings instead of FIFOs.
+/// @note argv[1] and argv[2] are paths of the rings to create: checker to user and user to checker.
+/// The returned `ofstream` is not connected yet; pass it to `useShmOutput` once it has reached its final place.
+/// @return Tuple of test input reader, user input stream and `AlgotesterReader` from user output stream.
+tuple<AlgotesterReader, ofstream, AlgotesterReader> initShmInteractiveChecker(int argc, char* argv[])
+{
+    IGNORE_BROKEN_PIPE;
+    static_cast<void>(argc);
+    static ShmRingOutBuf to_user(ShmRing::create(argv[1]));
+    static ShmRingInBuf from_user(ShmRing::create(argv[2]));
+    static istream from_user_stream(&from_user);
+    shmCheckerOutput() = &to_user;
+    return {AlgotesterReader(&cin, false), ofstream(), AlgotesterReader(&from_user_stream, false)};
+}
+
+/// @brief Connect the user input stream returned by `initShmInteractiveChecker` to its ring.
+/// @note `ofstream` resets its buffer when moved, so this can only be done after the tuple has been unpacked.
+void useShmOutput(ofstream& user_in)
+{
+    user_in.basic_ios<char>::rdbuf(shmCheckerOutput());
+}
+
+/// @brief Redirect `cin` and `cout` of a solution to the rings created by the checker.
+/// @note Streams are restored and the output ring is closed on destruction.
+class ShmStdio
+{
+public:
+    /// @param in_path Ring from the checker to the solution.
+    /// @param out_path Ring from the solution to the checker.
+    ShmStdio(const string& in_path, const string& out_path): in(ShmRing::attach(in_path)), out(ShmRing::attach(out_path))
+    {
+        old_in = cin.rdbuf(&in);
+        old_out = cout.rdbuf(&out);
+    }
+
+    ~ShmStdio()
+    {
+        cout.flush();
+        out.close();
+        cin.rdbuf(old_in);
+        cout.rdbuf(old_out);
+    }
+
+private:
+    ShmRingInBuf in;
+    ShmRingOutBuf out;
+    streambuf* old_in;
+    streambuf* old_out;
+};
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "algotester.h"
+#include "shm_ring.h"
+using namespace std;
+
+// Connects a solution that only knows stdin/stdout to the shared-memory rings of the checker.
+// Usage: ./shm_shim <checker to solution ring> <solution to checker ring> <solution> [solution args...]
+
+extern char** environ;
+
+int main(int argc, char* argv[])
+{
+    check(argc >= 4, "Usage: ./shm_shim <checker to solution ring> <solution to checker ring> <solution> [solution args...]");
+    signal(SIGPIPE, SIG_IGN);
+
+    ShmRing* from_checker = ShmRing::attach(argv[1]);
+    ShmRing* to_checker = ShmRing::attach(argv[2]);
+    from_checker->setReader();
+    to_checker->setWriter();
+
+    int solution_in[2], solution_out[2];
+    check(pipe(solution_in) == 0 && pipe(solution_out) == 0, "Cannot create pipes");
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, solution_in[0], 0);
+    posix_spawn_file_actions_adddup2(&actions, solution_out[1], 1);
+    posix_spawn_file_actions_addclose(&actions, solution_in[1]);
+    posix_spawn_file_actions_addclose(&actions, solution_out[0]);
+
+    pid_t pid;
+    check(posix_spawnp(&pid, argv[3], &actions, nullptr, argv + 3, environ) == 0, string("Cannot start ") + argv[3]);
+    posix_spawn_file_actions_destroy(&actions);
+    close(solution_in[0]);
+    close(solution_out[1]);
+
+    // Checker -> solution
+    thread forward([&]() {
+        const char* data;
+        size_t len;
+        while ((len = from_checker->peek(data)) > 0)
+        {
+            size_t done = 0;
+            while (done < len)
+            {
+                ssize_t res = write(solution_in[1], data + done, len - done);
+                if (res <= 0)
+                    break;
+                done += res;
+            }
+            from_checker->consume(len);
+            if (done < len)
+                break;
+        }
+        close(solution_in[1]);
+    });
+
+    // Solution -> checker
+    vector<char> buffer(1 << 16);
+    ssize_t len;
+    while ((len = read(solution_out[0], buffer.data(), buffer.size())) > 0)
+        if (!to_checker->write(buffer.data(), len))
+            break;
+    to_checker->close();
+
+    int status;
+    waitpid(pid, &status, 0);
+    forward.join();
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
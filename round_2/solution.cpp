@@ -8,8 +8,20 @@
 #include <string>
 #include <math.h>
 #include <algorithm>
+#include <numeric>
+#include <memory>
+#include <climits>
+#include <unordered_map>
+#include <fstream>
+#include <chrono>
+#include <immintrin.h>
 // #include "algotester.h"
 // #include "algotester_generator.h"
+// The submission is this file alone: the shared-memory transport is only compiled into local builds
+// (make passes -DSHM_TRANSPORT), a plain build talks to the checker over stdin/stdout or through ./shm_shim
+#ifdef SHM_TRANSPORT
+#include "shm_ring.h"
+#endif
 using namespace std;
 
 #define FOR(i,a,b) for (int i = (a); i < (b); i++)
@@ -29,92 +41,757 @@ typedef pair<LL, LL> PII;
 const int INF = 1000 * 1000 * 1000 + 7;
 const LL LINF = INF * (LL) INF;
 
+// Cluster state: the trusted part of state.h. The submission is this file alone, so it keeps its own copy,
+// keep the two in sync.
 struct VMType
 {
     int cpu;
     int mem;
     int price;
 
-    VMType(int cpu, int mem, int price)
+    VMType(int cpu, int mem, int price): cpu(cpu), mem(mem), price(price) {}
+};
+
+/// @brief Index of the cheapest VM type that fits the container, -1 if none does. The first one on ties.
+inline int cheapestVMType(const std::vector<VMType>& types, int cpu, int mem)
+{
+    int ind = -1;
+    for (int i = 0; i < (int)types.size(); i++)
+        if (types[i].cpu >= cpu && types[i].mem >= mem && (ind == -1 || types[i].price < types[ind].price))
+            ind = i;
+    return ind;
+}
+
+struct VM
+{
+    int type; // 0-based
+    int start_time; // step of creation, the VM hosts containers from start_time + d
+    int shutdown_time = -1;
+    int cpu_used = 0;
+    int mem_used = 0;
+};
+
+struct Container
+{
+    int cpu;
+    int mem;
+    int arrival;
+    int duration = -1; // only known to the checker
+    int vm = -1;
+    int allocation_time = -1;
+};
+
+/// @brief Records in a vector indexed by id, live ids in a separate list for iteration.
+template<class T>
+class DenseStorage
+{
+public:
+    bool contains(int id) const { return id >= 0 && id < (int)pos.size() && pos[id] != -1; }
+    T& operator[](int id) { return items[id]; }
+    const T& operator[](int id) const { return items[id]; }
+    int size() const { return live.size(); }
+
+    T& insert(int id, const T& value)
+    {
+        if (id >= (int)items.size())
+        {
+            items.resize(2 * id + 1);
+            pos.resize(2 * id + 1, -1);
+        }
+        items[id] = value;
+        pos[id] = live.size();
+        live.push_back(id);
+        return items[id];
+    }
+
+    void erase(int id)
+    {
+        int last = live.back();
+        live[pos[id]] = last;
+        pos[last] = pos[id];
+        live.pop_back();
+        pos[id] = -1;
+    }
+
+    /// @brief Call f(id, record) for every record, in no particular order.
+    template<class F>
+    void forEach(F f) const
+    {
+        for (int id : live)
+            f(id, items[id]);
+    }
+
+private:
+    std::vector<T> items;
+    std::vector<int> pos; // in live, -1 if absent
+    std::vector<int> live;
+};
+
+/// @brief Records in a hash map.
+template<class T>
+class HashedStorage
+{
+public:
+    bool contains(int id) const { return items.count(id) != 0; }
+    T& operator[](int id) { return items.find(id)->second; }
+    const T& operator[](int id) const { return items.find(id)->second; }
+    int size() const { return items.size(); }
+    T& insert(int id, const T& value) { return items.insert_or_assign(id, value).first->second; }
+    void erase(int id) { items.erase(id); }
+
+    template<class F>
+    void forEach(F f) const
     {
-        this->cpu = cpu;
-        this->mem = mem;
-        this->price = price;
+        for (auto& [id, item] : items)
+            f(id, item);
     }
+
+private:
+    std::unordered_map<int, T> items;
 };
 
-vector<VMType> vm_types;
+enum StateOp { OP_CONTAINER_NEW, OP_ASSIGN, OP_CONTAINER_END, OP_VM_CREATE, OP_VM_SHUTDOWN, STATE_OPS };
 
-struct VM {
-    int type;
-    int free_cpu;
-    int free_mem;
-    int ind;
-    int start_time;
+struct NoInstrumentation
+{
+    void count(StateOp) {}
+    void print(std::ostream&) const {}
+};
+
+struct CountingInstrumentation
+{
+    long long counts[STATE_OPS] = {};
 
-    VM() {}
-    VM(int type_ind, int start)
+    void count(StateOp op) { counts[op]++; }
+
+    void print(std::ostream& out) const
     {
-        this->type = type_ind;
-        this->free_cpu = vm_types[type_ind].cpu;
-        this->free_mem = vm_types[type_ind].mem;
-        this->start_time = start;
+        static const char* names[STATE_OPS] = {"container_new", "assign", "container_end", "vm_create", "vm_shutdown"};
+        out << "state:";
+        for (int i = 0; i < STATE_OPS; i++)
+            out << ' ' << names[i] << ' ' << counts[i];
+        out << '\n';
     }
 };
 
-map<int, VM> vms;
+template<template<class> class VMStorage, template<class> class ContainerStorage, class Instrumentation = NoInstrumentation>
+class Cluster
+{
+public:
+    std::vector<VMType> types;
+    int d = 0;
+    VMStorage<VM> vms;
+    ContainerStorage<Container> containers;
+    long long unallocated = 0; // containers that arrived and were not assigned yet
+    Instrumentation instrumentation;
 
-struct Container
+    int freeCpu(const VM& vm) const { return types[vm.type].cpu - vm.cpu_used; }
+    int freeMem(const VM& vm) const { return types[vm.type].mem - vm.mem_used; }
+    bool idle(const VM& vm) const { return vm.cpu_used == 0 && vm.mem_used == 0; }
+
+    Container& containerNew(int j, int id, int cpu, int mem, int duration = -1)
+    {
+        instrumentation.count(OP_CONTAINER_NEW);
+        unallocated++;
+        Container container;
+        container.cpu = cpu;
+        container.mem = mem;
+        container.arrival = j;
+        container.duration = duration;
+        return containers.insert(id, container);
+    }
+
+    /// @brief Container `cont_id` takes its resources on `vm_id` from step j.
+    /// @note VMs that are not ready yet are accepted, so that capacity can be reserved in advance.
+    Container& assign(int j, int cont_id, int vm_id)
+    {
+        instrumentation.count(OP_ASSIGN);
+        Container& container = containers[cont_id];
+        VM& vm = vms[vm_id];
+        vm.cpu_used += container.cpu;
+        vm.mem_used += container.mem;
+        container.vm = vm_id;
+        container.allocation_time = j;
+        unallocated--;
+        return container;
+    }
+
+    /// @brief The container ends and leaves the cluster, the resources it held are released.
+    void containerEnd(int j, int cont_id)
+    {
+        instrumentation.count(OP_CONTAINER_END);
+        Container& container = containers[cont_id];
+        if (container.vm != -1)
+        {
+            VM& vm = vms[container.vm];
+            vm.cpu_used -= container.cpu;
+            vm.mem_used -= container.mem;
+        }
+        else
+            unallocated--;
+        containers.erase(cont_id);
+    }
+
+    /// @param type 0-based VM type.
+    VM& vmCreate(int j, int vm_id, int type)
+    {
+        instrumentation.count(OP_VM_CREATE);
+        VM vm;
+        vm.type = type;
+        vm.start_time = j;
+        return vms.insert(vm_id, vm);
+    }
+
+    /// @brief Marks the VM as shut down at step j. The record is kept, so that the id can not be reused.
+    void vmShutdown(int j, int vm_id)
+    {
+        instrumentation.count(OP_VM_SHUTDOWN);
+        vms[vm_id].shutdown_time = j;
+    }
+};
+
+// Build with -DSTATE_COUNTERS to count state operations (printed with --stats)
+#ifdef STATE_COUNTERS
+typedef CountingInstrumentation StateInstrumentation;
+#else
+typedef NoInstrumentation StateInstrumentation;
+#endif
+
+// VM ids are chosen by the solution and stored densely, container ids are chosen by the checker (up to 1e9)
+Cluster<DenseStorage, HashedStorage, StateInstrumentation> cluster;
+vector<VMType>& vm_types = cluster.types;
+auto& vms = cluster.vms;
+auto& containers = cluster.containers;
+
+// Free capacities of live VMs as structure of arrays, so that fit scans are vectorized.
+// Slots are kept dense (removal moves the last slot) and padded with infeasible entries to a multiple of 8.
+struct Fleet
 {
-    int cpu;
-    int mem;
-    int vm_ind;
+    VI free_cpu;
+    VI free_mem;
+    VI vm_id;
+    VI slot_of; // by VM id
+    int size = 0;
+    LL total_free_cpu = 0, total_free_mem = 0;
+    // Packing score: the age of the VM, its residual capacity, or the imbalance of its residual capacity
+    enum Score { OLDEST, RESIDUAL, BALANCE };
+    Score score = OLDEST;
+    int mem_per_cpu = 1; // weight of a unit of cpu in the residual
+
+    // Free cpu (in units of memory) minus free memory: positive if the VM has cpu left that memory-heavy
+    // containers can use, negative if it has memory left for cpu-heavy ones
+    LL imbalance(LL cpu, LL mem) const
+    {
+        return cpu * mem_per_cpu - mem;
+    }
+
+    // Slab view: for every frequent container shape, the VMs that can host one more container of it,
+    // ordered by id so that the oldest one (the one the fit scan would choose) comes first
+    static const int SLAB_MIN_ARRIVALS = 16; // arrivals of a shape before it gets a slab
+    static const int MAX_SLABS = 64;
+    bool use_slabs = true;
+    unordered_map<LL, int> shape_arrivals;
+    unordered_map<LL, int> slab_of; // by shape
+    vector<pair<int, int>> slab_shape;
+    vector<set<int>> slab_hosts;
+    LL slab_hits = 0, slab_misses = 0, rare_shapes = 0;
+
+    static LL shape_key(int cpu, int mem)
+    {
+        return ((LL) cpu << 32) | (unsigned) mem;
+    }
+
+    // Slab of the shape, -1 for rare shapes. Counts the arrival.
+    int slab(int cpu, int mem)
+    {
+        LL key = shape_key(cpu, mem);
+        auto it = slab_of.find(key);
+        if (it != slab_of.end())
+            return it->second;
+        if (++shape_arrivals[key] < SLAB_MIN_ARRIVALS || SZ(slab_shape) == MAX_SLABS)
+            return -1;
+
+        int ind = SZ(slab_shape);
+        slab_of[key] = ind;
+        slab_shape.PB(MP(cpu, mem));
+        slab_hosts.PB(set<int>());
+        FOR (i, 0, size)
+            if (free_cpu[i] >= cpu && free_mem[i] >= mem)
+                slab_hosts[ind].insert(vm_id[i]);
+        return ind;
+    }
+
+    void update_slabs(int id, int cpu, int mem)
+    {
+        FOR (k, 0, SZ(slab_shape))
+        {
+            if (cpu >= slab_shape[k].first && mem >= slab_shape[k].second)
+                slab_hosts[k].insert(id);
+            else
+                slab_hosts[k].erase(id);
+        }
+    }
+
+    void add(int id, int cpu, int mem)
+    {
+        if (size % 8 == 0)
+        {
+            free_cpu.resize(size + 8, -1);
+            free_mem.resize(size + 8, -1);
+            vm_id.resize(size + 8, -1);
+        }
+        if (id >= SZ(slot_of))
+            slot_of.resize(2 * id + 1, -1);
+        free_cpu[size] = cpu;
+        free_mem[size] = mem;
+        total_free_cpu += cpu;
+        total_free_mem += mem;
+        vm_id[size] = id;
+        slot_of[id] = size++;
+        update_slabs(id, cpu, mem);
+    }
 
-    Container() {}
-    Container(int cpu, int mem)
+    void update(int id, int cpu, int mem)
     {
-        this->cpu = cpu;
-        this->mem = mem;
-        this->vm_ind = -1;
+        int slot = slot_of[id];
+        total_free_cpu += cpu - free_cpu[slot];
+        total_free_mem += mem - free_mem[slot];
+        free_cpu[slot] = cpu;
+        free_mem[slot] = mem;
+        update_slabs(id, cpu, mem);
+    }
+
+    void remove(int id)
+    {
+        update_slabs(id, -1, -1);
+        int slot = slot_of[id];
+        total_free_cpu -= free_cpu[slot];
+        total_free_mem -= free_mem[slot];
+        int last = --size;
+        free_cpu[slot] = free_cpu[last];
+        free_mem[slot] = free_mem[last];
+        vm_id[slot] = vm_id[last];
+        slot_of[vm_id[slot]] = slot;
+        free_cpu[last] = free_mem[last] = vm_id[last] = -1;
+        slot_of[id] = -1;
     }
 };
 
-map<int, Container> containers;
+Fleet fleet;
 
-int find_vm_type(int cpu, int mem)
+// The feasible slot with the smallest packing score, the first such slot on ties. Returns -1 if the container fits nowhere.
+// The score is the VM id by default (first fit on the oldest VM, which lets younger VMs drain and shut down),
+// the residual `(free_cpu - cpu) * mem_per_cpu + (free_mem - mem)` for best fit, or the absolute imbalance
+// `|(free_cpu - cpu) * mem_per_cpu - (free_mem - mem)|` left after placing, which puts cpu-heavy containers
+// next to memory-heavy ones.
+int best_fit_scalar(const Fleet& f, int cpu, int mem)
 {
-    int best_price = INF;
-    int ind = -1;
+    int best = -1;
+    int best_score = INT_MAX;
+    FOR (i, 0, f.size)
+    {
+        if (f.free_cpu[i] >= cpu && f.free_mem[i] >= mem)
+        {
+            int score = f.vm_id[i];
+            if (f.score == Fleet::RESIDUAL)
+                score = (f.free_cpu[i] - cpu) * f.mem_per_cpu + (f.free_mem[i] - mem);
+            else if (f.score == Fleet::BALANCE)
+                score = abs((f.free_cpu[i] - cpu) * f.mem_per_cpu - (f.free_mem[i] - mem));
+            if (score < best_score)
+            {
+                best_score = score;
+                best = i;
+            }
+        }
+    }
+    return best;
+}
+
+// Same as best_fit_scalar, 8 slots per instruction
+__attribute__((target("avx2")))
+int best_fit_avx2(const Fleet& f, int cpu, int mem)
+{
+    const __m256i need_cpu = _mm256_set1_epi32(cpu - 1);
+    const __m256i need_mem = _mm256_set1_epi32(mem - 1);
+    const __m256i cpu_vec = _mm256_set1_epi32(cpu);
+    const __m256i mem_vec = _mm256_set1_epi32(mem);
+    const __m256i weight = _mm256_set1_epi32(f.mem_per_cpu);
+    const __m256i step = _mm256_set1_epi32(8);
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i best_score = _mm256_set1_epi32(INT_MAX);
+    __m256i best_index = _mm256_set1_epi32(-1);
+
+    for (int i = 0; i < f.size; i += 8)
+    {
+        __m256i fc = _mm256_loadu_si256((const __m256i*) (f.free_cpu.data() + i));
+        __m256i fm = _mm256_loadu_si256((const __m256i*) (f.free_mem.data() + i));
+        __m256i fits = _mm256_and_si256(_mm256_cmpgt_epi32(fc, need_cpu), _mm256_cmpgt_epi32(fm, need_mem));
+        __m256i score = _mm256_loadu_si256((const __m256i*) (f.vm_id.data() + i));
+        if (f.score == Fleet::RESIDUAL)
+            score = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(fc, cpu_vec), weight), _mm256_sub_epi32(fm, mem_vec));
+        else if (f.score == Fleet::BALANCE)
+            score = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(fc, cpu_vec), weight), _mm256_sub_epi32(fm, mem_vec)));
+        // Strictly better only, so every lane keeps its first best slot
+        __m256i better = _mm256_and_si256(fits, _mm256_cmpgt_epi32(best_score, score));
+        best_score = _mm256_blendv_epi8(best_score, score, better);
+        best_index = _mm256_blendv_epi8(best_index, index, better);
+        index = _mm256_add_epi32(index, step);
+    }
+
+    int scores[8], indices[8];
+    _mm256_storeu_si256((__m256i*) scores, best_score);
+    _mm256_storeu_si256((__m256i*) indices, best_index);
+    int best = -1;
+    FOR (k, 0, 8)
+        if (indices[k] != -1 && (best == -1 || scores[k] < scores[best] || (scores[k] == scores[best] && indices[k] < indices[best])))
+            best = k;
+    return best == -1 ? -1 : indices[best];
+}
+
+int (*best_fit)(const Fleet&, int, int) = __builtin_cpu_supports("avx2") ? best_fit_avx2 : best_fit_scalar;
+
+// Slot for a container: the head of its slab for frequent shapes, the fit scan for rare ones
+int find_slot(Fleet& f, int cpu, int mem)
+{
+    int ind = f.use_slabs && f.score == Fleet::OLDEST ? f.slab(cpu, mem) : -1;
+    if (ind == -1)
+    {
+        ++f.rare_shapes;
+        return best_fit(f, cpu, mem);
+    }
+    auto& hosts = f.slab_hosts[ind];
+    if (hosts.empty())
+    {
+        ++f.slab_misses;
+        return -1;
+    }
+    ++f.slab_hits;
+    return f.slot_of[*hosts.begin()];
+}
+
+// Type of a new VM for a container under the balance score: among the types at most BALANCE_PRICE_SLACK more
+// expensive than the cheapest one that fits, the one that leaves the whole fleet with the smallest imbalance,
+// so that the new VM has spare capacity in the dimension the residual capacity of the fleet lacks.
+const double BALANCE_PRICE_SLACK = 0.1;
+
+int find_balanced_vm_type(const Fleet& f, int cpu, int mem)
+{
+    int cheapest = cheapestVMType(vm_types, cpu, mem);
+    int ind = cheapest;
+    LL best_imbalance = LINF;
     FOR (i, 0, SZ(vm_types))
     {
-        if (vm_types[i].cpu >= cpu && vm_types[i].mem >= mem && vm_types[i].price < best_price)
+        if (vm_types[i].cpu < cpu || vm_types[i].mem < mem || vm_types[i].price > (1 + BALANCE_PRICE_SLACK) * vm_types[cheapest].price)
+            continue;
+        LL imbalance = abs(f.imbalance(f.total_free_cpu + vm_types[i].cpu - cpu, f.total_free_mem + vm_types[i].mem - mem));
+        if (imbalance < best_imbalance || (imbalance == best_imbalance && vm_types[i].price < vm_types[ind].price))
         {
-            best_price = vm_types[i].price;
+            best_imbalance = imbalance;
             ind = i;
         }
     }
-
     return ind;
 }
 
-int find_vm(int cpu, int mem)
+// Capacity that no container can use, by VM type. Containers need between min_ratio and max_ratio memory
+// per unit of cpu, so a VM strands the cpu its free memory cannot accompany, `free_cpu - free_mem / min_ratio`,
+// and the memory its free cpu cannot accompany, `free_mem - free_cpu * max_ratio`. Sampled every step.
+struct Fragmentation
+{
+    double min_ratio = INF, max_ratio = 0; // observed memory per unit of cpu
+    vector<LL> vm_steps;
+    vector<double> stranded_cpu, stranded_mem;
+
+    void observe(int cpu, int mem)
+    {
+        min_ratio = min(min_ratio, (double) mem / cpu);
+        max_ratio = max(max_ratio, (double) mem / cpu);
+    }
+
+    void sample(int steps)
+    {
+        if (max_ratio == 0)
+            return;
+        vm_steps.resize(SZ(vm_types));
+        stranded_cpu.resize(SZ(vm_types));
+        stranded_mem.resize(SZ(vm_types));
+        vms.forEach([&](int id, const VM& vm)
+        {
+            int free_cpu = cluster.freeCpu(vm), free_mem = cluster.freeMem(vm);
+            vm_steps[vm.type] += steps;
+            stranded_cpu[vm.type] += steps * max(0.0, free_cpu - free_mem / min_ratio);
+            stranded_mem[vm.type] += steps * max(0.0, free_mem - free_cpu * max_ratio);
+        });
+    }
+
+    void print(ostream& out)
+    {
+        out << "stranded capacity by VM type (time average, % of capacity):\n";
+        double cpu = 0, mem = 0, total_cpu = 0, total_mem = 0;
+        FOR (i, 0, SZ(vm_steps))
+        {
+            if (vm_steps[i] == 0)
+                continue;
+            double capacity_cpu = (double) vm_steps[i] * vm_types[i].cpu, capacity_mem = (double) vm_steps[i] * vm_types[i].mem;
+            out << "  type " << i + 1 << " (" << vm_types[i].cpu << " cpu, " << vm_types[i].mem << " mem): " << vm_steps[i] << " VM-steps, cpu "
+                << 100 * stranded_cpu[i] / capacity_cpu << "%, mem " << 100 * stranded_mem[i] / capacity_mem << "%\n";
+            cpu += stranded_cpu[i], mem += stranded_mem[i];
+            total_cpu += capacity_cpu, total_mem += capacity_mem;
+        }
+        if (total_cpu > 0)
+            out << "  all: cpu " << 100 * cpu / total_cpu << "%, mem " << 100 * mem / total_mem << "%\n";
+    }
+};
+
+Fragmentation fragmentation;
+
+// Online inference of tenant bursts. Containers arriving close in time with a similar memory/cpu ratio are assumed
+// to come from one tenant and to be released together, so they are placed on the VMs of their burst first.
+struct Bursts
 {
-    auto best_itr = vms.end();
-    for (auto itr=vms.begin();itr!=vms.begin();++itr) {
-        if (itr->second.free_cpu >= cpu && itr->second.free_mem >= mem) {
-            if (best_itr == vms.end() || (itr->second.free_cpu >= best_itr->second.free_cpu && itr->second.free_mem >= best_itr->second.free_mem))
-                best_itr = itr;
+    static const int MAX_GAP = 8; // steps between arrivals of one burst
+    static const int MAX_VMS = 8; // remembered VMs of a burst
+
+    struct Burst
+    {
+        int last_arrival;
+        int ratio;
+        VI vms;
+    };
+
+    bool enabled = false;
+    vector<Burst> bursts;
+    VI recent; // bursts that can still grow
+    unordered_map<int, int> container_burst; // by container id, -1 until the container is first placed
+    LL affinity_hits = 0;
+
+    int& of(int cont_id)
+    {
+        return container_burst.emplace(cont_id, -1).first->second;
+    }
+
+    static int ratio_class(int cpu, int mem)
+    {
+        // mem/cpu is between 2 and 8 GiB per core in the tests
+        return (int) round(2 * log2((mem / 1024.0) / (cpu / 400.0)));
+    }
+
+    int assign(int j, int cpu, int mem)
+    {
+        int ratio = ratio_class(cpu, mem);
+        VI still_recent;
+        int res = -1;
+        for (int b : recent)
+        {
+            if (bursts[b].last_arrival < j - MAX_GAP)
+                continue;
+            still_recent.PB(b);
+            if (res == -1 && bursts[b].ratio == ratio)
+                res = b;
+        }
+        recent = still_recent;
+        if (res == -1)
+        {
+            res = SZ(bursts);
+            bursts.PB({j, ratio, VI()});
+            recent.PB(res);
         }
+        bursts[res].last_arrival = j;
+        return res;
+    }
+
+    // The oldest VM of the burst that fits the container, -1 if none
+    int slot(const Fleet& f, int burst, int cpu, int mem)
+    {
+        int best = -1;
+        for (int id : bursts[burst].vms)
+        {
+            int s = f.slot_of[id];
+            if (s != -1 && f.free_cpu[s] >= cpu && f.free_mem[s] >= mem && (best == -1 || id < f.vm_id[best]))
+                best = s;
+        }
+        affinity_hits += best != -1;
+        return best;
+    }
+
+    void record(int burst, int vm_id)
+    {
+        VI& vms = bursts[burst].vms;
+        if (find(ALL(vms), vm_id) != vms.end())
+            return;
+        if (SZ(vms) == MAX_VMS)
+            vms.erase(vms.begin());
+        vms.PB(vm_id);
     }
-    return best_itr->second.ind;
+};
+
+Bursts bursts;
+
+// Packing of the containers that need new VMs in the same step into fewer, larger VMs.
+// The containers are not held for later arrivals: those can already join a VM that is still being created without
+// any extra delay, while every step of holding costs at least 10 * 0.1 * 1.1^d of penalty per held container,
+// more than the reservation of a whole shared VM for the default d = 40, and lowered the score on every test tried.
+struct Admission
+{
+    bool pack = false;
+    ofstream log;
+};
+
+Admission admission;
+
+// Groups containers into new VMs: first fit decreasing, the type of every VM is the one with the smallest
+// price per packed load among the types that fit the largest remaining container.
+const double SHARED_VM_DISCOUNT = 0.9;
+
+vector<pair<int, VI>> pack_containers(VI pending, int mem_per_cpu)
+{
+    auto load = [&](int ind) { return (LL) containers[ind].cpu * mem_per_cpu + containers[ind].mem; };
+    VI order = pending;
+    sort(ALL(pending), [&](int a, int b) { return load(a) > load(b); });
+    vector<bool> packed(SZ(pending), false);
+    vector<pair<int, VI>> res;
+
+    FOR (i, 0, SZ(pending))
+    {
+        if (packed[i])
+            continue;
+        auto& first = containers[pending[i]];
+        double best_cost = 1e18;
+        int best_type = -1;
+        VI best_group;
+        FOR (type, 0, SZ(vm_types))
+        {
+            if (vm_types[type].cpu < first.cpu || vm_types[type].mem < first.mem)
+                continue;
+            int free_cpu = vm_types[type].cpu, free_mem = vm_types[type].mem;
+            LL packed_load = 0;
+            VI group;
+            FOR (k, i, SZ(pending))
+            {
+                auto& cont = containers[pending[k]];
+                if (packed[k] || cont.cpu > free_cpu || cont.mem > free_mem)
+                    continue;
+                free_cpu -= cont.cpu;
+                free_mem -= cont.mem;
+                packed_load += load(pending[k]);
+                group.PB(k);
+            }
+            double cost = vm_types[type].price / (double) packed_load;
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_type = type;
+                best_group = group;
+            }
+        }
+        // A shared VM lives as long as its longest container, so it pays off only if it is clearly cheaper
+        // than separate VMs for the same containers
+        double separate_price = 0;
+        for (int k : best_group)
+            separate_price += vm_types[cheapestVMType(vm_types, containers[pending[k]].cpu, containers[pending[k]].mem)].price;
+        if (vm_types[best_type].price > SHARED_VM_DISCOUNT * separate_price)
+        {
+            best_type = cheapestVMType(vm_types, first.cpu, first.mem);
+            best_group = {i};
+        }
+        VI group;
+        for (int k : best_group)
+        {
+            packed[k] = true;
+            group.PB(pending[k]);
+        }
+        res.PB(MP(best_type, group));
+    }
+
+    // VMs are numbered in the order of arrival of their first container, like without packing,
+    // so that the oldest-VM placement sees the same order
+    unordered_map<int, int> position;
+    FOR (k, 0, SZ(order))
+        position[order[k]] = k;
+    VI first_arrival(SZ(res), INF);
+    FOR (v, 0, SZ(res))
+        for (int ind : res[v].second)
+            first_arrival[v] = min(first_arrival[v], position[ind]);
+    VI by_arrival(SZ(res));
+    iota(ALL(by_arrival), 0);
+    sort(ALL(by_arrival), [&](int a, int b) { return first_arrival[a] < first_arrival[b]; });
+    vector<pair<int, VI>> sorted;
+    for (int v : by_arrival)
+        sorted.PB(move(res[v]));
+    return sorted;
+    return res;
 }
 
-void clear_resources(int cont_ind)
+// Time budget of the whole interaction. The remaining time is projected from the remaining steps and the
+// measured time per step of every tier, and the solution moves between tiers so that the projection stays
+// below TARGET of the time limit:
+//   FULL: the configured policy (packing, bursts, balance)
+//   GREEDY: every container on its own with the fit scan, no packing and no bursts
+//   FALLBACK: the newest VM if the container fits, a new VM otherwise, O(1) per container
+// Early steps have arrivals in every step while later ones are mostly idle and batched, so the projection
+// overestimates at first and no tier is dropped before WARMUP of the time limit.
+struct Budget
+{
+    enum Tier { FULL, GREEDY, FALLBACK, TIERS };
+    static const int CHECK_STEPS = 1024; // steps between clock reads
+    static constexpr double TARGET = 0.7;
+    static constexpr double WARMUP = 0.05;
+
+    double time_limit = 30; // seconds, like the interactor
+    Tier tier = FULL;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    double last_elapsed = 0;
+    int last_step = 0;
+    double step_time[TIERS] = {0, 0, 0}; // EWMA of seconds per step, 0 until the tier has run
+    int switches = 0;
+
+    static const char* name(int tier)
+    {
+        static const char* names[] = {"full", "greedy", "fallback"};
+        return names[tier];
+    }
+
+    void update(int j, int t)
+    {
+        if (j < last_step + CHECK_STEPS)
+            return;
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        double rate = (elapsed - last_elapsed) / (j - last_step);
+        step_time[tier] = step_time[tier] == 0 ? rate : 0.8 * step_time[tier] + 0.2 * rate;
+        last_elapsed = elapsed;
+        last_step = j;
+
+        auto projected = [&](int tier) { return elapsed + (t - j) * step_time[tier]; };
+        Tier next = tier;
+        if (projected(tier) > TARGET * time_limit && elapsed > WARMUP * time_limit && tier + 1 < TIERS)
+            next = Tier(tier + 1);
+        else if (tier > FULL && step_time[tier - 1] > 0 && projected(tier - 1) < TARGET * time_limit / 2)
+            next = Tier(tier - 1);
+        if (next == tier)
+            return;
+        cerr << "budget: step " << j << "/" << t << ", " << elapsed << "s elapsed, " << projected(tier) << "s projected: "
+             << name(tier) << " -> " << name(next) << '\n';
+        tier = next;
+        ++switches;
+    }
+};
+
+Budget budget;
+
+// VMs that became empty in this step, to be shut down at its end
+set<int> emptied_vms;
+
+void release_container(int j, int cont_id)
 {
-    auto cont = containers.find(cont_ind)->second;
-    auto vm = vms.find(cont.vm_ind);
-    vm->second.free_cpu += cont.cpu;
-    vm->second.free_mem += cont.mem;
+    int vm_id = containers[cont_id].vm;
+    cluster.containerEnd(j, cont_id);
+    bursts.container_burst.erase(cont_id);
+    if (vm_id == -1)
+        return;
+    auto& vm = vms[vm_id];
+    fleet.update(vm_id, cluster.freeCpu(vm), cluster.freeMem(vm));
+    if (cluster.idle(vm))
+        emptied_vms.insert(vm_id);
 }
 
 int main(int argc, char* argv[])
@@ -123,6 +800,51 @@ int main(int argc, char* argv[])
     cin.tie(nullptr);
     cout.tie(nullptr);
 
+    // --shm <checker to solution ring> <solution to checker ring>: talk to the checker over shared memory (SHM_TRANSPORT builds)
+    // --best-fit: place containers by the residual capacity instead of the oldest VM
+    // --balance: place containers by the imbalance of the residual capacity and pick VM types that balance the fleet
+    // --scalar: do not use the AVX2 fit scan
+    // --no-slabs: place every container with the fit scan
+    // --pack: pack the containers that need new VMs in the same step together
+    // --decision-log <path>: write packing decisions to the file
+    // --bursts: place containers of an inferred burst on the same VMs
+    // --time_limit <seconds>: time limit of the whole interaction, 30 by default
+    // --stats: print statistics to stderr at the end, including the stranded capacity
+#ifdef SHM_TRANSPORT
+    unique_ptr<ShmStdio> shm;
+#endif
+    bool print_stats = false;
+    FOR (i, 1, argc)
+    {
+        string arg = argv[i];
+#ifdef SHM_TRANSPORT
+        if (arg == "--shm" && i + 2 < argc)
+        {
+            shm = make_unique<ShmStdio>(argv[i + 1], argv[i + 2]);
+            i += 2;
+        }
+        else
+#endif
+        if (arg == "--best-fit")
+            fleet.score = Fleet::RESIDUAL;
+        else if (arg == "--balance")
+            fleet.score = Fleet::BALANCE;
+        else if (arg == "--scalar")
+            best_fit = best_fit_scalar;
+        else if (arg == "--no-slabs")
+            fleet.use_slabs = false;
+        else if (arg == "--pack")
+            admission.pack = true;
+        else if (arg == "--decision-log" && i + 1 < argc)
+            admission.log.open(argv[++i]);
+        else if (arg == "--bursts")
+            bursts.enabled = true;
+        else if (arg == "--time_limit" && i + 1 < argc)
+            budget.time_limit = atof(argv[++i]);
+        else if (arg == "--stats")
+            print_stats = true;
+    }
+
 
     int m, d;
     cin >> m >> d;
@@ -134,6 +856,12 @@ int main(int argc, char* argv[])
 
         vm_types.PB(VMType(cpu, mem, price));
     }
+    cluster.d = d;
+
+    LL total_cpu = 0, total_mem = 0;
+    for (auto& type : vm_types)
+        total_cpu += type.cpu, total_mem += type.mem;
+    fleet.mem_per_cpu = max(1LL, total_mem / max(1LL, total_cpu));
 
 //    list<pair<int, int>> unavailible_vms;
     list<int> new_containers;
@@ -144,6 +872,38 @@ int main(int argc, char* argv[])
     stringstream output;
     int cnt_out = 0;
 
+    // Containers waiting for new VMs
+    VI pending;
+    auto create_vms = [&](int j)
+    {
+        vector<pair<int, VI>> new_vms;
+        if (admission.pack && budget.tier == Budget::FULL)
+            new_vms = pack_containers(pending, fleet.mem_per_cpu);
+        else
+            for (int ind : pending)
+                new_vms.PB(MP(fleet.score == Fleet::BALANCE && budget.tier != Budget::FALLBACK
+                              ? find_balanced_vm_type(fleet, containers[ind].cpu, containers[ind].mem)
+                              : cheapestVMType(vm_types, containers[ind].cpu, containers[ind].mem), VI(1, ind)));
+        if (admission.log.is_open() && !pending.empty())
+            admission.log << "step " << j << " packed " << SZ(pending) << " containers into " << SZ(new_vms) << " VMs\n";
+        for (auto& [type, group] : new_vms)
+        {
+            cluster.vmCreate(j, cnt_vms, type);
+            for (int ind : group)
+            {
+                cluster.assign(j, ind, cnt_vms);
+                containers_to_allocate[j+d].push_back(ind);
+                if (bursts.enabled && bursts.of(ind) != -1)
+                    bursts.record(bursts.of(ind), cnt_vms);
+            }
+            ++cnt_out;
+            output << 1 << ' ' << cnt_vms << ' ' << type+1  << '\n';
+            fleet.add(cnt_vms, cluster.freeCpu(vms[cnt_vms]), cluster.freeMem(vms[cnt_vms]));
+            ++cnt_vms;
+        }
+        pending.clear();
+    };
+
     int t;
     cin >> t;
     FOR (j, 0, t)
@@ -154,6 +914,8 @@ int main(int argc, char* argv[])
 
         int cnt = 1;
         if (e == 0) cin >> cnt;
+        budget.update(j, t);
+        bool full = budget.tier == Budget::FULL;
 
 //        list<int> freed_vms;
         FOR (k, 0, e)
@@ -164,8 +926,8 @@ int main(int argc, char* argv[])
             {
                 int id, cpu, mem;
                 cin >> id >> cpu >> mem;
-                Container cont(cpu, mem);
-                containers[id] = cont;
+                cluster.containerNew(j, id, cpu, mem);
+                fragmentation.observe(cpu, mem);
                 new_containers.push_back(id);
             }
             if (type == 2)
@@ -176,56 +938,61 @@ int main(int argc, char* argv[])
             }
         }
 
-        for (auto vm = vms.begin(); vm != vms.end(); ++vm) {
-            for (int ind : new_containers) {
-                auto cont = containers.find(ind);
-                if (cont->second.vm_ind == -1 && vm->second.free_cpu >= cont->second.cpu && vm->second.free_mem >= cont->second.mem) {
-                    cont->second.vm_ind = vm->second.ind;
-                    vm->second.free_cpu -= cont->second.cpu;
-                    vm->second.free_mem -= cont->second.mem;
-
-                    if (vm->second.start_time <= j) {
-                        ++cnt_out;
-                        output << 3 << ' ' << ind << ' ' << vm->second.ind << '\n';
-                    } else
-                        containers_to_allocate[vm->second.start_time].push_back(ind);
-                }
-            }
-        }
-
+        // The whole batch of arrivals is placed against the fleet, best fit for every container
         for (int ind : new_containers) {
-            auto cont = containers.find(ind);
-            if (cont->second.vm_ind != -1)
+            auto& cont = containers[ind];
+            int slot = -1;
+            if (budget.tier == Budget::FALLBACK)
+            {
+                int newest = cnt_vms - 1 < SZ(fleet.slot_of) ? fleet.slot_of[cnt_vms - 1] : -1;
+                if (newest != -1 && fleet.free_cpu[newest] >= cont.cpu && fleet.free_mem[newest] >= cont.mem)
+                    slot = newest;
+                else
+                    continue;
+            }
+            if (bursts.enabled && full)
+            {
+                if (bursts.of(ind) == -1)
+                    bursts.of(ind) = bursts.assign(j, cont.cpu, cont.mem);
+                slot = bursts.slot(fleet, bursts.of(ind), cont.cpu, cont.mem);
+            }
+            if (slot == -1)
+                slot = find_slot(fleet, cont.cpu, cont.mem);
+            if (slot == -1)
                 continue;
+            int vm_id = fleet.vm_id[slot];
+            if (bursts.enabled && bursts.of(ind) != -1)
+                bursts.record(bursts.of(ind), vm_id);
+            cluster.assign(j, ind, vm_id);
+            auto& vm = vms[vm_id];
+            fleet.update(vm_id, cluster.freeCpu(vm), cluster.freeMem(vm));
 
-            VM vm(find_vm_type(cont->second.cpu, cont->second.mem), j+d);
-            vm.free_cpu -= cont->second.cpu;
-            vm.free_mem -= cont->second.mem;
-            vm.ind = cnt_vms;
-            ++cnt_out;
-            output << 1 << ' ' << cnt_vms << ' ' << vm.type+1  << '\n';
-            vms[cnt_vms] = vm;
-            cont->second.vm_ind = cnt_vms;
-            ++cnt_vms;
-            containers_to_allocate[j+d].push_back(ind);
+            if (vm.start_time + d <= j) {
+                ++cnt_out;
+                output << 3 << ' ' << ind << ' ' << vm_id << '\n';
+            } else
+                containers_to_allocate[vm.start_time + d].push_back(ind);
         }
+
+        for (int ind : new_containers)
+            if (containers[ind].vm == -1)
+                pending.PB(ind);
         new_containers.clear();
+        create_vms(j);
 
         for (int ind : shutdown_containers) {
-            clear_resources(ind);
-            containers.erase(ind);
+            release_container(j, ind);
         }
         shutdown_containers.clear();
+        if (print_stats)
+            fragmentation.sample(cnt);
 
-        list<int> to_erase;
-        for (auto vm : vms) {
-            if (vm.second.free_cpu == vm_types[vm.second.type].cpu && vm.second.free_mem == vm_types[vm.second.type].mem) {
-                to_erase.push_back(vm.second.ind);
-            }
-        }
+        // Only a shutdown can empty a VM, so the VMs to shut down are exactly those emptied in this step
+        list<int> to_erase(ALL(emptied_vms));
+        emptied_vms.clear();
 
         for(int ind : containers_to_allocate[j]) {
-            output << 3 << ' ' << ind << ' ' << containers[ind].vm_ind << '\n';
+            output << 3 << ' ' << ind << ' ' << containers[ind].vm << '\n';
             ++cnt_out;
         }
 
@@ -237,7 +1004,9 @@ int main(int argc, char* argv[])
         output.clear();
 
         for (auto ind : to_erase) {
+            cluster.vmShutdown(j, ind);
             vms.erase(ind);
+            fleet.remove(ind);
             output << 2 << ' ' << ind << '\n';
             ++cnt_out;
         }
@@ -247,8 +1016,8 @@ int main(int argc, char* argv[])
             j++;
 
             for(int ind : containers_to_allocate[j]) {
-                if (containers.find(ind) != containers.end()) {
-                    output << 3 << ' ' << ind << ' ' << containers[ind].vm_ind << '\n';
+                if (containers.contains(ind)) {
+                    output << 3 << ' ' << ind << ' ' << containers[ind].vm << '\n';
                     ++cnt_out;
                 }
             }
@@ -276,6 +1045,19 @@ int main(int argc, char* argv[])
         // :(
     }
 
+    if (print_stats)
+    {
+        LL placements = fleet.slab_hits + fleet.slab_misses + fleet.rare_shapes;
+        cerr << "slabs: " << SZ(fleet.slab_shape) << " shapes, " << fleet.slab_hits << " hits, " << fleet.slab_misses << " empty, "
+             << fleet.rare_shapes << " rare of " << placements << " placements (hit rate "
+             << (placements ? 100.0 * fleet.slab_hits / placements : 0.0) << "%)\n";
+        cerr << "budget: " << budget.switches << " tier switches, ended in " << Budget::name(budget.tier) << " tier\n";
+        if (bursts.enabled)
+            cerr << "bursts: " << SZ(bursts.bursts) << " inferred, " << bursts.affinity_hits << " placements on a VM of the burst\n";
+        fragmentation.print(cerr);
+        cluster.instrumentation.print(cerr);
+    }
+
 }
 
 
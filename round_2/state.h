@@ -0,0 +1,276 @@
+// Cluster state shared by the checker, the scorer and the tools: VM types, VMs, containers and their accounting.
+// solution.cpp is submitted as a single file and carries a copy of the trusted part, keep the two in sync.
+//
+// Cluster<Storage, Validation, Instrumentation> is configured at compile time:
+//  * Storage         - DenseStorage (vectors indexed by id, for small dense ids chosen by the program itself)
+//                      or HashedStorage (hash maps, for ids chosen by someone else);
+//  * Validation      - StrictValidation (every action is checked against the rules of the problem and a failure
+//                      is reported with the message of the checker) or TrustedValidation (no checks at all);
+//  * Instrumentation - NoInstrumentation or CountingInstrumentation (number of every operation).
+// The operations are named after the callbacks of LogVisitor, so a cluster follows a checker log directly.
+
+#pragma once
+#include <functional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct VMType
+{
+    int cpu;
+    int mem;
+    int price;
+
+    VMType(int cpu, int mem, int price): cpu(cpu), mem(mem), price(price) {}
+};
+
+/// @brief Index of the cheapest VM type that fits the container, -1 if none does. The first one on ties.
+inline int cheapestVMType(const std::vector<VMType>& types, int cpu, int mem)
+{
+    int ind = -1;
+    for (int i = 0; i < (int)types.size(); i++)
+        if (types[i].cpu >= cpu && types[i].mem >= mem && (ind == -1 || types[i].price < types[ind].price))
+            ind = i;
+    return ind;
+}
+
+struct VM
+{
+    int type; // 0-based
+    int start_time; // step of creation, the VM hosts containers from start_time + d
+    int shutdown_time = -1;
+    int cpu_used = 0;
+    int mem_used = 0;
+};
+
+struct Container
+{
+    int cpu;
+    int mem;
+    int arrival;
+    int duration = -1; // only known to the checker
+    int vm = -1;
+    int allocation_time = -1;
+};
+
+/// @brief Arrival (type 1) or end (type 2) of a container, as queued by the checker.
+struct Event
+{
+    int type;
+    int time;
+    int container_id;
+
+    Event(int type, int time, int container_id): type(type), time(time), container_id(container_id) {}
+};
+
+/// @brief Records in a vector indexed by id, live ids in a separate list for iteration.
+template<class T>
+class DenseStorage
+{
+public:
+    bool contains(int id) const { return id >= 0 && id < (int)pos.size() && pos[id] != -1; }
+    T& operator[](int id) { return items[id]; }
+    const T& operator[](int id) const { return items[id]; }
+    int size() const { return live.size(); }
+
+    T& insert(int id, const T& value)
+    {
+        if (id >= (int)items.size())
+        {
+            items.resize(2 * id + 1);
+            pos.resize(2 * id + 1, -1);
+        }
+        items[id] = value;
+        pos[id] = live.size();
+        live.push_back(id);
+        return items[id];
+    }
+
+    void erase(int id)
+    {
+        int last = live.back();
+        live[pos[id]] = last;
+        pos[last] = pos[id];
+        live.pop_back();
+        pos[id] = -1;
+    }
+
+    /// @brief Call f(id, record) for every record, in no particular order.
+    template<class F>
+    void forEach(F f) const
+    {
+        for (int id : live)
+            f(id, items[id]);
+    }
+
+private:
+    std::vector<T> items;
+    std::vector<int> pos; // in live, -1 if absent
+    std::vector<int> live;
+};
+
+/// @brief Records in a hash map.
+template<class T>
+class HashedStorage
+{
+public:
+    bool contains(int id) const { return items.count(id) != 0; }
+    T& operator[](int id) { return items.find(id)->second; }
+    const T& operator[](int id) const { return items.find(id)->second; }
+    int size() const { return items.size(); }
+    T& insert(int id, const T& value) { return items.insert_or_assign(id, value).first->second; }
+    void erase(int id) { items.erase(id); }
+
+    template<class F>
+    void forEach(F f) const
+    {
+        for (auto& [id, item] : items)
+            f(id, item);
+    }
+
+private:
+    std::unordered_map<int, T> items;
+};
+
+/// @brief Checks every action, `fail` is called with the message of the first violated rule and must not return.
+struct StrictValidation
+{
+    static const bool enabled = true;
+    std::function<void(const std::string&)> fail;
+};
+
+struct TrustedValidation
+{
+    static const bool enabled = false;
+    std::function<void(const std::string&)> fail;
+};
+
+enum StateOp { OP_CONTAINER_NEW, OP_ASSIGN, OP_CONTAINER_END, OP_VM_CREATE, OP_VM_SHUTDOWN, STATE_OPS };
+
+struct NoInstrumentation
+{
+    void count(StateOp) {}
+    void print(std::ostream&) const {}
+};
+
+struct CountingInstrumentation
+{
+    long long counts[STATE_OPS] = {};
+
+    void count(StateOp op) { counts[op]++; }
+
+    void print(std::ostream& out) const
+    {
+        static const char* names[STATE_OPS] = {"container_new", "assign", "container_end", "vm_create", "vm_shutdown"};
+        out << "state:";
+        for (int i = 0; i < STATE_OPS; i++)
+            out << ' ' << names[i] << ' ' << counts[i];
+        out << '\n';
+    }
+};
+
+template<template<class> class Storage, class Validation = TrustedValidation, class Instrumentation = NoInstrumentation>
+class Cluster
+{
+public:
+    std::vector<VMType> types;
+    int d = 0;
+    Storage<VM> vms;
+    Storage<Container> containers;
+    long long unallocated = 0; // containers that arrived and were not assigned yet
+    Validation validation;
+    Instrumentation instrumentation;
+
+    int freeCpu(const VM& vm) const { return types[vm.type].cpu - vm.cpu_used; }
+    int freeMem(const VM& vm) const { return types[vm.type].mem - vm.mem_used; }
+    bool idle(const VM& vm) const { return vm.cpu_used == 0 && vm.mem_used == 0; }
+
+    Container& containerNew(int j, int id, int cpu, int mem, int duration = -1)
+    {
+        instrumentation.count(OP_CONTAINER_NEW);
+        unallocated++;
+        Container container;
+        container.cpu = cpu;
+        container.mem = mem;
+        container.arrival = j;
+        container.duration = duration;
+        return containers.insert(id, container);
+    }
+
+    /// @brief Container `cont_id` takes its resources on `vm_id` from step j.
+    /// @note A trusted cluster accepts VMs that are not ready yet, so that the solution can reserve capacity in advance.
+    Container& assign(int j, int cont_id, int vm_id)
+    {
+        instrumentation.count(OP_ASSIGN);
+        if (Validation::enabled)
+        {
+            require(containers.contains(cont_id) && containers[cont_id].vm == -1, "No such container request, or it has already been allocated");
+            require(vms.contains(vm_id), "VM with such identifier has not been created yet");
+            const VM& vm = vms[vm_id];
+            require(vm.shutdown_time == -1 || vm.shutdown_time == j, "VM has already been shut down");
+            require(vm.shutdown_time != j, "VM is scheduled to shut down on this step");
+            require(j >= vm.start_time + d, "VM is not ready to host containers");
+            require(vm.cpu_used + containers[cont_id].cpu <= types[vm.type].cpu, "VM doesn't have enough CPUs to host container");
+            require(vm.mem_used + containers[cont_id].mem <= types[vm.type].mem, "VM doesn't have enough memory to host container");
+        }
+        Container& container = containers[cont_id];
+        VM& vm = vms[vm_id];
+        vm.cpu_used += container.cpu;
+        vm.mem_used += container.mem;
+        container.vm = vm_id;
+        container.allocation_time = j;
+        unallocated--;
+        return container;
+    }
+
+    /// @brief The container ends and leaves the cluster, the resources it held are released.
+    void containerEnd(int j, int cont_id)
+    {
+        instrumentation.count(OP_CONTAINER_END);
+        Container& container = containers[cont_id];
+        if (container.vm != -1)
+        {
+            VM& vm = vms[container.vm];
+            vm.cpu_used -= container.cpu;
+            vm.mem_used -= container.mem;
+        }
+        else
+            unallocated--;
+        containers.erase(cont_id);
+    }
+
+    /// @param type 0-based VM type.
+    VM& vmCreate(int j, int vm_id, int type)
+    {
+        instrumentation.count(OP_VM_CREATE);
+        if (Validation::enabled)
+            require(!vms.contains(vm_id), "VM with such identifier has already been created");
+        VM vm;
+        vm.type = type;
+        vm.start_time = j;
+        return vms.insert(vm_id, vm);
+    }
+
+    /// @brief Marks the VM as shut down at step j. The record is kept, so that the id can not be reused.
+    void vmShutdown(int j, int vm_id)
+    {
+        instrumentation.count(OP_VM_SHUTDOWN);
+        if (Validation::enabled)
+        {
+            require(vms.contains(vm_id), "VM with such identifier has not been created yet");
+            const VM& vm = vms[vm_id];
+            require(vm.shutdown_time == -1 || vm.shutdown_time == j, "VM can not be shut down because it is has been already shut down");
+            require(vm.shutdown_time != j, "VM has already been scheduled to shut down");
+            require(idle(vm), "VM can not be shut down because it hosts containers");
+        }
+        vms[vm_id].shutdown_time = j;
+    }
+
+private:
+    void require(bool condition, const char* message)
+    {
+        if (!condition)
+            validation.fail(message);
+    }
+};
@@ -0,0 +1,185 @@
+import argparse
+import concurrent.futures
+import hashlib
+import json
+import os
+import statistics
+import subprocess
+import tempfile
+
+from test_cache import DEFAULT_CACHE_DIR, TestCache, command_hash
+
+# Runs a solution on a range of generator seeds through ./harness, several seeds at a time,
+# and aggregates scores and resource usage. Results are cached by everything that can change them (see run_key),
+# so a rerun only evaluates seeds that were not run with the same solution, checker, test and time limit yet.
+# This relies on the run being reproducible: the harness passes the checker the same arguments on every run, so
+# the random stream the checker seeds from them is the same too. Only a solution that adapts to its own running time
+# can still score differently on a rerun.
+# With --bound, every score is also reported as a percentage of the clairvoyant bound of its test (./offline_bound).
+
+# Bumped whenever cached results stop being comparable with new runs.
+# 2: the harness no longer passes the checker a random log path, which changed its random stream on every run.
+CACHE_VERSION = 2
+
+def parse_seeds(spec):
+    seeds = []
+    for part in spec.split(','):
+        if '-' in part:
+            first, last = part.split('-')
+            seeds += range(int(first), int(last) + 1)
+        else:
+            seeds.append(int(part))
+    return seeds
+
+def load_cache(path):
+    if path is None or not os.path.exists(path):
+        return {}
+    with open(path) as f:
+        return json.load(f)
+
+def save_cache(path, cache):
+    if path is None:
+        return
+    with open(path + ".tmp", "w") as f:
+        json.dump(cache, f, indent=1, sort_keys=True)
+    os.replace(path + ".tmp", path)
+
+def run_bound(bound, test_file):
+    process = subprocess.run(bound.strip().split(' ') + [test_file], stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, text=True)
+    return int(process.stdout) if process.returncode == 0 else 0
+
+def run_key(solution, seed, *, harness="./harness", generator="./generator", checker="./checker", time_limit=30, test_cache=None, bound=None):
+    """Cache key of a run: the cache version, the seed, the binaries and full command lines of the solution, the harness, the checker
+    and the bound, the time limit and the test (its cache key, or the generator command)."""
+    parts = [str(CACHE_VERSION), str(seed), command_hash(solution), command_hash(harness), command_hash(checker), str(time_limit),
+             test_cache.key([seed]) if test_cache is not None else command_hash(generator),
+             command_hash(bound) if bound is not None else ""]
+    return hashlib.sha256("\0".join(parts).encode()).hexdigest()[:24]
+
+def run_seed(solution, seed, *, harness="./harness", generator="./generator", checker="./checker", time_limit=30, test_cache=None, bound=None):
+    with tempfile.TemporaryDirectory(prefix="sweep_") as tmp:
+        args = harness.strip().split(' ') + ["--solution", solution, "--checker", checker, "--time_limit", str(time_limit), "--fused"]
+        if test_cache is not None:
+            test_file = test_cache.get([seed])
+            args += ["--test_file", test_file]
+        else:
+            test_file = os.path.join(tmp, "test")
+            args += ["--test_file", test_file, "--seed", str(seed), "--generator", generator]
+        process = subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+        bound_score = run_bound(bound, test_file) if bound is not None and os.path.exists(test_file) else 0
+    try:
+        result = json.loads(process.stdout)
+    except json.JSONDecodeError:
+        result = {"verdict": "error", "message": process.stderr.strip() or "harness produced no report", "processes": {}}
+    solution_stats = result["processes"].get("solution", {})
+    score = result.get("score", 0)
+    return {
+        "seed": seed,
+        "verdict": result["verdict"],
+        "message": result.get("message", ""),
+        "score": score,
+        "bound": bound_score,
+        "optimal_pct": 100.0 * score / bound_score if bound_score else 0.0,
+        "wall_s": solution_stats.get("wall_s", 0),
+        "cpu_s": solution_stats.get("user_s", 0) + solution_stats.get("sys_s", 0),
+        "max_rss_kb": solution_stats.get("max_rss_kb", 0),
+        "latency_p99_us": result.get("latency", {}).get("p99_us", 0),
+    }
+
+def sweep(solution, seeds, *, jobs=None, cache_file=None, on_result=None, **run_args):
+    """Evaluate the solution on all seeds, reusing cached results. Returns results in the order of seeds."""
+    cache = load_cache(cache_file)
+    keys = {seed: run_key(solution, seed, **run_args) for seed in seeds}
+    results = {}
+    todo = []
+    for seed in seeds:
+        if keys[seed] in cache:
+            results[seed] = cache[keys[seed]]
+        else:
+            todo.append(seed)
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=jobs or os.cpu_count()) as pool:
+        futures = {pool.submit(run_seed, solution, seed, **run_args): seed for seed in todo}
+        for future in concurrent.futures.as_completed(futures):
+            result = future.result()
+            results[result["seed"]] = result
+            if result["verdict"] == "ok":
+                cache[keys[result["seed"]]] = result
+            if on_result is not None:
+                on_result(result)
+
+    save_cache(cache_file, cache)
+    return [results[seed] for seed in seeds], len(seeds) - len(todo)
+
+def summarize(values):
+    if not values:
+        return {}
+    return {
+        "mean": statistics.mean(values),
+        "median": statistics.median(values),
+        "stddev": statistics.stdev(values) if len(values) > 1 else 0.0,
+        "min": min(values),
+        "max": max(values),
+    }
+
+def main():
+    parser = argparse.ArgumentParser(description="Runs a solution on a range of generator seeds in parallel and reports score and runtime statistics.")
+
+    parser.add_argument("--solution",   required=True,             help='Path to the solution executable. (i.e: \'./executable\', \'java executable\')')
+    parser.add_argument("--seeds",      default = "1-20",          help='Seeds to run: ranges and lists, e.g. \'1-100\' or \'1,5,10-20\' (default: %(default)s).')
+    parser.add_argument("--jobs",       type=int,                  help='How many seeds are run at the same time (default: number of CPUs).')
+    parser.add_argument("--time_limit", default = 30, type=int,    help='How long the solution is allowed to run on one seed (in seconds).')
+    parser.add_argument("--harness",    default = "./harness",     help='Path to the harness executable (default: \'%(default)s\').')
+    parser.add_argument("--checker",    default = "./checker",     help='Path to the checker executable (default: \'%(default)s\').')
+    parser.add_argument("--generator",  default = "./generator",   help='Path to the generator executable (default: \'%(default)s\').')
+    parser.add_argument("--cache",      default = ".sweep_cache.json", help='File with cached results, \'\' to disable caching (default: \'%(default)s\').')
+    parser.add_argument("--test_cache", default = DEFAULT_CACHE_DIR, help='Directory of the generated test cache, \'\' to generate tests on every run (default: \'%(default)s\').')
+    parser.add_argument("--bound",                                 help='Path to ./offline_bound: report every score as a percentage of the clairvoyant bound of its test.')
+    parser.add_argument("--json",                                  help='Write per-seed results and statistics to this file.')
+    parser.add_argument("--quiet",      action="store_true",       help="Print only the summary.")
+    args = parser.parse_args()
+
+    seeds = parse_seeds(args.seeds)
+    test_cache = TestCache(args.test_cache, args.generator) if args.test_cache else None
+    on_result = None if args.quiet else lambda r: print(f"seed {r['seed']:>6}: {r['verdict']:>7} score {r['score']:>8} "
+                                                        + (f"({r['optimal_pct']:5.2f}% of bound {r['bound']}) " if args.bound else "")
+                                                        + f"time {r['wall_s']:7.3f}s rss {r['max_rss_kb'] // 1024:5d}MB {r['message']}", flush=True)
+    try:
+        results, cached = sweep(args.solution, seeds, jobs=args.jobs, cache_file=args.cache or None, on_result=on_result,
+                                harness=args.harness, generator=args.generator, checker=args.checker, time_limit=args.time_limit,
+                                test_cache=test_cache, bound=args.bound)
+    finally:
+        if test_cache is not None:
+            test_cache.release()
+
+    ok = [r for r in results if r["verdict"] == "ok"]
+    failed = [r for r in results if r["verdict"] != "ok"]
+    summary = {
+        "seeds": len(seeds),
+        "cached": cached,
+        "failed": [r["seed"] for r in failed],
+        "score": summarize([r["score"] for r in ok]),
+        "optimal_pct": summarize([r["optimal_pct"] for r in ok if r.get("bound")]),
+        "wall_s": summarize([r["wall_s"] for r in ok]),
+        "cpu_s": summarize([r["cpu_s"] for r in ok]),
+        "max_rss_kb": summarize([r["max_rss_kb"] for r in ok]),
+    }
+
+    print()
+    print(f"Seeds: {len(seeds)} ({cached} cached), failed: {len(failed)}")
+    for name in ("score", "optimal_pct", "wall_s", "cpu_s", "max_rss_kb"):
+        s = summary[name]
+        if s:
+            print(f"{name:>11}: mean {s['mean']:12.3f}  median {s['median']:12.3f}  stddev {s['stddev']:12.3f}  min {s['min']:12.3f}  max {s['max']:12.3f}")
+    if ok:
+        worst = min(ok, key=lambda r: r["score"])
+        print(f"Worst seed: {worst['seed']} (score {worst['score']})")
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"solution": args.solution, "summary": summary, "results": results}, f, indent=2)
+
+    exit(1 if failed else 0)
+
+if __name__ == "__main__":
+    main()
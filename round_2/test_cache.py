@@ -0,0 +1,128 @@
+import argparse
+import functools
+import gzip
+import hashlib
+import os
+import shutil
+import subprocess
+import tempfile
+import threading
+from collections import defaultdict
+
+# Content-addressed cache of generated tests. The output of the generator depends only on its binary
+# and its arguments, so tests are stored compressed under a hash of (generator command and the contents of the files
+# it names, argv) and generated only on the first request.
+#
+# Tests are served decompressed from /dev/shm when it is available: the checker reads them from memory
+# instead of the disk, and all runs of the same seed in one process share one copy. release() removes the copies
+# of the process when it is done, --release removes the copies of all processes.
+
+DEFAULT_CACHE_DIR = ".test_cache"
+
+_locks_guard = threading.Lock()
+_locks = defaultdict(threading.Lock)
+
+def file_hash(path):
+    digest = hashlib.sha256()
+    with open(path, "rb") as f:
+        for chunk in iter(lambda: f.read(1 << 20), b""):
+            digest.update(chunk)
+    return digest.hexdigest()[:16]
+
+@functools.lru_cache(maxsize=None)
+def command_hash(command):
+    """Hash of a command: all of its arguments and the contents of those that name files, so that both the binary
+    and a script run by an interpreter (python3 gen.py) are covered."""
+    digest = hashlib.sha256()
+    for i, arg in enumerate(command.strip().split(' ')):
+        path = (shutil.which(arg) if i == 0 else None) or arg
+        digest.update(b"\0" + arg.encode())
+        if os.path.isfile(path):
+            digest.update(b"\0" + file_hash(path).encode())
+    return digest.hexdigest()[:16]
+
+def serve_dir():
+    return "/dev/shm" if os.path.isdir("/dev/shm") else tempfile.gettempdir()
+
+class TestCache:
+    def __init__(self, cache_dir=DEFAULT_CACHE_DIR, generator="./generator"):
+        self.cache_dir = cache_dir
+        self.generator = generator
+        self.generator_hash = command_hash(generator)
+        self.served = set()
+        os.makedirs(cache_dir, exist_ok=True)
+
+    def key(self, args):
+        digest = hashlib.sha256(self.generator_hash.encode())
+        for arg in args:
+            digest.update(b"\0" + str(arg).encode())
+        return digest.hexdigest()[:24]
+
+    def compressed(self, args):
+        """Path of the compressed test, generating it if needed."""
+        path = os.path.join(self.cache_dir, self.key(args) + ".gz")
+        if os.path.exists(path):
+            return path
+        # Write to a temporary file first, so that concurrent runs never see a partial test
+        fd, tmp = tempfile.mkstemp(dir=self.cache_dir, suffix=".tmp")
+        with os.fdopen(fd, "wb") as raw, gzip.GzipFile(fileobj=raw, mode="wb", compresslevel=6, mtime=0) as out:
+            generator_args = self.generator.strip().split(' ') + [str(arg) for arg in args]
+            process = subprocess.Popen(generator_args, stdout=subprocess.PIPE)
+            shutil.copyfileobj(process.stdout, out, 1 << 20)
+            if process.wait() != 0:
+                os.remove(tmp)
+                raise RuntimeError(f"Generator failed with code {process.returncode}: <{' '.join(generator_args)}>")
+        os.chmod(tmp, 0o644)
+        os.replace(tmp, path)
+        return path
+
+    def get(self, args, dest=None):
+        """Path of the decompressed test: `dest` if given, otherwise a copy in memory shared by all runs."""
+        # Runs of the same test wait for one generator instead of starting their own
+        with _locks_guard:
+            lock = _locks[self.key(args)]
+        with lock:
+            source = self.compressed(args)
+        if dest is None:
+            dest = os.path.join(serve_dir(), f"test_cache_{os.getpid()}_{self.key(args)}")
+            if os.path.exists(dest):
+                return dest
+            self.served.add(dest)
+        fd, tmp = tempfile.mkstemp(dir=os.path.dirname(os.path.abspath(dest)), suffix=".tmp")
+        with os.fdopen(fd, "wb") as out, gzip.open(source, "rb") as test:
+            shutil.copyfileobj(test, out, 1 << 20)
+        os.chmod(tmp, 0o644)
+        os.replace(tmp, dest)
+        return dest
+
+    def release(self):
+        """Remove the tests this cache served from memory."""
+        for path in self.served:
+            if os.path.exists(path):
+                os.remove(path)
+        self.served.clear()
+
+def release_all():
+    """Remove the tests served from memory by all processes."""
+    for name in os.listdir(serve_dir()):
+        if name.startswith("test_cache_"):
+            os.remove(os.path.join(serve_dir(), name))
+
+def main():
+    parser = argparse.ArgumentParser(description="Content-addressed cache of generated tests.")
+
+    parser.add_argument("--generator",  default = "./generator",     help='Path to the generator executable (default: \'%(default)s\').')
+    parser.add_argument("--cache_dir",  default = DEFAULT_CACHE_DIR, help='Directory with compressed tests (default: \'%(default)s\').')
+    parser.add_argument("--output",                                  help='Write the test to this file instead of serving it from memory.')
+    parser.add_argument("--release",    action="store_true",         help="Remove the tests served from memory and exit.")
+    parser.add_argument("args",         nargs="*",                   help="Generator arguments, e.g. the seed.")
+    args = parser.parse_args()
+
+    if args.release:
+        release_all()
+        return
+    cache = TestCache(args.cache_dir, args.generator)
+    print(cache.get(args.args, args.output))
+
+if __name__ == "__main__":
+    main()
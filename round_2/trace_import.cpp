@@ -0,0 +1,246 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "vm_catalog.h"
+
+using namespace std;
+
+// Converts a CSV cluster trace to a test.
+//
+// Usage: ./trace_import <trace.csv> <test> [catalog=<1|2>] [d=<delay>] [compress=<factor>] [cpu_unit=<cores>] [mem_unit=<GiB>]
+//
+// Every row is one container: arrival time, tenant, cpu (cores), mem (GiB), duration. A header row is optional;
+// if present, columns are matched by name (time/arrival, tenant, cpu, mem/memory, duration), otherwise taken in this order.
+// The tenant is not used and may be any text, and its column may be missing if there is a header.
+// Rows must be sorted by arrival time. The trace is read twice (to count the containers first), so memory does not
+// depend on its size; a trace that can not be read twice (a pipe) is first copied to a temporary file. Arrival times are shifted to start at 0 and divided by `compress`. CPU is rounded up to
+// multiples of 400, memory to multiples of 1024, both are clamped to the limits of the tests.
+
+const int T = (int) 2e7;
+
+enum Column { TIME, TENANT, CPU, MEM, DURATION, COLUMNS };
+
+struct Options {
+    int catalog = 1;
+    int d = 40;
+    double compress = 1;
+    double cpu_unit = 1;
+    double mem_unit = 1;
+};
+
+// Splits a CSV line in place
+int split(char *line, vector<char*> &fields) {
+    fields.clear();
+    char *p = line;
+    while (true) {
+        fields.push_back(p);
+        while (*p && *p != ',' && *p != '\n' && *p != '\r')
+            p++;
+        if (*p != ',') {
+            *p = 0;
+            break;
+        }
+        *p++ = 0;
+    }
+    return fields.size();
+}
+
+bool is_number(const char *s) {
+    char *end;
+    strtod(s, &end);
+    return end != s;
+}
+
+class TraceReader {
+public:
+    TraceReader(const char *path) : path(path) {
+        file = fopen(path, "r");
+        if (!file) {
+            perror(path);
+            exit(1);
+        }
+        if (fseek(file, 0, SEEK_SET) != 0)
+            spool();
+        setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        for (int i = 0; i < COLUMNS; i++)
+            column[i] = i;
+    }
+
+    ~TraceReader() {
+        fclose(file);
+        free(line);
+    }
+
+    void rewind() {
+        if (fseek(file, 0, SEEK_SET) != 0) {
+            perror(path);
+            exit(1);
+        }
+        row = 0;
+    }
+
+    // Reads the next container, returns false at the end of the trace
+    bool next(double values[COLUMNS]) {
+        while (getline(&line, &capacity, file) != -1) {
+            row++;
+            if (split(line, fields) == 1 && fields[0][0] == 0)
+                continue;
+            if (row == 1 && !is_number(fields[0])) {
+                read_header();
+                continue;
+            }
+            for (int i = 0; i < COLUMNS; i++) {
+                if (i == TENANT)
+                    continue;
+                char *end = nullptr;
+                if (column[i] < (int) fields.size())
+                    values[i] = strtod(fields[column[i]], &end);
+                if (end == nullptr || end == fields[column[i]])
+                    fail("expected a number in column " + to_string(column[i] + 1));
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void fail(const string &message) {
+        fprintf(stderr, "%s:%lld: %s\n", path, row, message.c_str());
+        exit(1);
+    }
+
+private:
+    // Replaces a stream that can not be rewound with a temporary copy
+    void spool() {
+        FILE *copy = tmpfile();
+        if (!copy) {
+            perror("tmpfile");
+            exit(1);
+        }
+        char buffer[1 << 16];
+        size_t len;
+        while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+            if (fwrite(buffer, 1, len, copy) != len) {
+                perror("tmpfile");
+                exit(1);
+            }
+        if (ferror(file)) {
+            perror(path);
+            exit(1);
+        }
+        fclose(file);
+        file = copy;
+        ::rewind(file);
+    }
+
+    void read_header() {
+        const vector<vector<string>> names = {{"time", "arrival", "arrival_time"}, {"tenant"}, {"cpu"}, {"mem", "memory"}, {"duration"}};
+        for (int i = 0; i < COLUMNS; i++) {
+            column[i] = -1;
+            for (int j = 0; j < (int) fields.size(); j++)
+                for (auto &name : names[i])
+                    if (strcasecmp(fields[j], name.c_str()) == 0)
+                        column[i] = j;
+            if (column[i] == -1 && i != TENANT)
+                fail("no column for " + names[i][0] + " in the header");
+        }
+    }
+
+    const char *path;
+    FILE *file;
+    char *line = nullptr;
+    size_t capacity = 0;
+    long long row = 0;
+    vector<char*> fields;
+    int column[COLUMNS];
+};
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: ./trace_import <trace.csv> <test> [catalog=<1|2>] [d=<delay>] [compress=<factor>] [cpu_unit=<cores>] [mem_unit=<GiB>]\n");
+        return 1;
+    }
+    Options options;
+    for (int i = 3; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        double value = eq == string::npos ? 0 : atof(arg.c_str() + eq + 1);
+        if (key == "catalog")
+            options.catalog = value;
+        else if (key == "d")
+            options.d = value;
+        else if (key == "compress")
+            options.compress = value;
+        else if (key == "cpu_unit")
+            options.cpu_unit = value;
+        else if (key == "mem_unit")
+            options.mem_unit = value;
+        else {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if ((options.catalog != 1 && options.catalog != 2) || options.compress <= 0 || options.cpu_unit <= 0 || options.mem_unit <= 0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return 1;
+    }
+
+    TraceReader trace(argv[1]);
+    double values[COLUMNS];
+
+    // First pass: count containers and check the order of arrivals
+    long long n = 0;
+    double first_time = 0, prev_time = -INFINITY;
+    while (trace.next(values)) {
+        if (values[TIME] < prev_time)
+            trace.fail("rows are not sorted by arrival time");
+        if (n == 0)
+            first_time = values[TIME];
+        prev_time = values[TIME];
+        n++;
+    }
+    if (n == 0 || n > INT32_MAX) {
+        fprintf(stderr, "Trace must contain between 1 and %d containers\n", INT32_MAX);
+        return 1;
+    }
+
+    FILE *out = fopen(argv[2], "w");
+    if (!out) {
+        perror(argv[2]);
+        return 1;
+    }
+    setvbuf(out, nullptr, _IOFBF, 1 << 20);
+
+    vector<int> cpu, mem;
+    vector<double> price;
+    get_vm_types(options.catalog, cpu, mem, price);
+    fprintf(out, "%d %d\n", (int) cpu.size(), options.d);
+    for (size_t i = 0; i < cpu.size(); i++)
+        fprintf(out, "%d %d %g\n", cpu[i], mem[i], price[i]);
+    fprintf(out, "%lld\n", n);
+
+    // Second pass: convert
+    trace.rewind();
+    long long clamped = 0, id = 0;
+    while (trace.next(values)) {
+        long long time = (long long) ((values[TIME] - first_time) / options.compress);
+        long long c = (long long) ceil(values[CPU] * options.cpu_unit - 1e-9) * 400;
+        long long m = (long long) ceil(values[MEM] * options.mem_unit - 1e-9) * 1024;
+        long long duration = max(1LL, (long long) ceil(values[DURATION] - 1e-9));
+        if (c < 400 || c > MAX_CPU || m < 1024 || m > MAX_MEM)
+            clamped++;
+        c = min<long long>(max(c, 400LL), MAX_CPU);
+        m = min<long long>(max(m, 1024LL), MAX_MEM);
+        if (time + duration > T)
+            trace.fail("container does not end before step " + to_string(T) + ", use a larger compress factor");
+        fprintf(out, "%lld %lld %lld %lld %lld\n", time, ++id, c, m, duration);
+    }
+    fclose(out);
+
+    if (clamped)
+        fprintf(stderr, "%lld of %lld containers were clamped to the resource limits\n", clamped, n);
+    return 0;
+}
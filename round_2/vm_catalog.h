@@ -0,0 +1,39 @@
+// Predefined VM catalogs and container limits of the tests, shared by the generator and the trace importer.
+
+#pragma once
+#include <vector>
+#include <assert.h>
+
+const int MAX_CPU = 25600; // changed max cpu to 64 * 400
+const int MAX_MEM = 524288; // changed max memory to 512 * 1024
+
+inline void get_vm_types(int m_set, std::vector<int> &cpu, std::vector<int> &mem, std::vector<double> &price) {
+    if (m_set == 1) {
+        cpu = {3164, 4760, 6356, 9548, 12740, 19124, 25508, 38276, 51044};
+        mem = {59794, 90596, 121398, 185624, 249849, 378299, 506750, 763651, 1020552};
+        price = {456, 684, 911, 1367, 1823, 2734, 3646, 5469, 7292};
+    } else if (m_set == 2) {
+        cpu = {
+            376, 376, 772, 772, 772, 1568, 1568, 1568, 3164, 3164, 3164, 3164, 4760, 4760,
+            6356, 6356, 6356, 6356, 9548, 9548, 9548, 11144, 12740, 12740, 12740, 19124, 19124,
+            19124, 19124, 22316, 25508, 25508, 25508, 35084, 38276, 38276, 38276, 38276, 41468,
+            51044, 51044, 51044
+        };
+
+        mem = {
+            665, 1433, 1433, 3218, 7015, 3218, 7015, 14263, 7015, 14263, 29414, 59794, 44815,
+            90596, 14263, 29414, 59794, 121398, 44815, 90596, 185624, 342173, 59794, 121398,
+            249849, 90596, 185624, 378299, 956327, 691398, 121398, 249849, 506750, 169567,
+            185624, 378299, 763651, 1919706, 1464108, 249849, 506750, 1020552
+        };
+
+        price = {
+                86,    143,    229,    314,    486,    457,    629,    971,    943,   1300,
+              2029,   4558,   5157,   6836,   1871,   2600,   6876,   9115,   6329,  10314,
+             13673,  20471,   8429,  13753,  18230,  12657,  20629,  27344,  68113,  40943,
+             16857,  27505,  36459,  28900,  32311,  41258,  54689, 136226,  94486,  43082,
+             55011,  72918
+        };
+    }
+    assert(cpu.size() == mem.size() && cpu.size() == price.size());
+}